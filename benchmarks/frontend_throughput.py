@@ -0,0 +1,72 @@
+import os
+import random
+import subprocess
+import sys
+import tempfile
+import time
+
+#   Compares parsing throughput of the bison frontend and the hand-written one (--frontend=fast)
+#   on a generated program. Both runs use --parse-only, so the numbers cover lexing, parsing and
+#   AST construction but not execution.
+#
+#   usage: python3 frontend_throughput.py [statements] [repeats]
+
+def generate_program(statements, seed=1):
+    rnd = random.Random(seed)
+    names = ["a", "b", "c", "d", "e", "f", "g", "h"]
+    lines = [f"{name} = {n};" for n, name in enumerate(names)]
+
+    def expression(depth):
+        if depth == 0 or rnd.random() < 0.3:
+            return rnd.choice(names + [str(rnd.randint(0, 1000))])
+        op = rnd.choice(["+", "-", "*", "/", "%", "<", ">", "==", "!=", "<=", ">=", "&&", "||"])
+        lhs = expression(depth - 1)
+        rhs = expression(depth - 1)
+        return f"({lhs} {op} {rhs})" if rnd.random() < 0.3 else f"{lhs} {op} {rhs}"
+
+    while len(lines) < statements:
+        kind = rnd.random()
+        if kind < 0.6:
+            lines.append(f"{rnd.choice(names)} = {expression(3)};")
+        elif kind < 0.75:
+            lines.append(f"print {expression(2)};")
+        elif kind < 0.9:
+            lines.append(f"if ({expression(2)}) {{ {rnd.choice(names)} = {expression(2)}; }} else {rnd.choice(names)} = -{rnd.choice(names)};")
+        else:
+            lines.append(f"while ({expression(2)} && 0) {{ {rnd.choice(names)} = !{expression(2)}; }}")
+    return "\n".join(lines) + "\n"
+
+def measure(executable, frontend, source_path, repeats):
+    timings = []
+    for _ in range(repeats):
+        start = time.perf_counter()
+        subprocess.run([executable, f"--frontend={frontend}", "--parse-only", source_path], check=True,
+                       stdout=subprocess.DEVNULL)
+        timings.append(time.perf_counter() - start)
+    return sorted(timings)[len(timings) // 2]
+
+def main():
+    statements = int(sys.argv[1]) if len(sys.argv) > 1 else 200000
+    repeats = int(sys.argv[2]) if len(sys.argv) > 2 else 5
+    executable = os.path.join(os.path.dirname(__file__), "../build/paraCL")
+
+    if not os.path.isfile(executable) or not os.access(executable, os.X_OK):
+        print(f"File '{executable}' not found or not executable")
+        sys.exit(1)
+
+    with tempfile.NamedTemporaryFile("w", suffix=".pcl", delete=False) as source:
+        source.write(generate_program(statements))
+        source_path = source.name
+
+    try:
+        size_mb = os.path.getsize(source_path) / (1024 * 1024)
+        print(f"program: {statements} statements, {size_mb:.1f} MiB, median of {repeats} runs")
+        results = {frontend: measure(executable, frontend, source_path, repeats) for frontend in ("bison", "fast")}
+        for frontend, seconds in results.items():
+            print(f"  {frontend:>5}: {seconds * 1000:8.1f} ms  {size_mb / seconds:6.1f} MiB/s")
+        print(f"  speedup: {results['bison'] / results['fast']:.2f}x")
+    finally:
+        os.remove(source_path)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,123 @@
+import os
+import socket
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+#   Compares the time to serve many distinct programs sharing one large prologue
+#     - pasted    : every program carries the prologue text, so the server parses it every time
+#     - imported  : every program starts with import "prologue.pcl", the module is parsed once
+#   against a server started by this script (paraCL --serve <socket>), and the time to parse one
+#   program importing several large independent modules (compiled in parallel) with the time to
+#   parse the same statements pasted into one file (paraCL --parse-only <file>).
+#
+#   usage: python3 import_prologue.py [prologue statements] [programs]
+
+def make_prologue(statements, prefix="p"):
+    lines = [f"{prefix}0 = 1;"]
+    for n in range(1, statements):
+        lines.append(f"{prefix}{n} = ({prefix}{n - 1} * 3 + {n}) % 1000;")
+    return "\n".join(lines) + "\n"
+
+def make_body(n, last):
+    return f"n = ?;\nprint n + {n} + p{last};\n"
+
+def send_frame(sock, kind, payload):
+    sock.sendall(kind + struct.pack(">I", len(payload)) + payload)
+
+def receive_exact(sock, size):
+    data = b""
+    while len(data) < size:
+        chunk = sock.recv(size - len(data))
+        if not chunk:
+            raise ConnectionError("server closed the connection")
+        data += chunk
+    return data
+
+def socket_request(socket_path, program, program_name):
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as sock:
+        sock.connect(socket_path)
+        send_frame(sock, b"T", program.encode())
+        send_frame(sock, b"N", program_name.encode())
+        send_frame(sock, b"I", b"1\n")
+        send_frame(sock, b"E", b"")
+        output = b""
+        while True:
+            header = receive_exact(sock, 5)
+            payload = receive_exact(sock, struct.unpack(">I", header[1:])[0])
+            if header[:1] == b"O":
+                output += payload
+            elif header[:1] == b"X":
+                return output.decode()
+
+def serve_all(socket_path, programs, program_name):
+    start = time.perf_counter()
+    outputs = [socket_request(socket_path, program, program_name) for program in programs]
+    return time.perf_counter() - start, outputs
+
+def parse_time(executable, path, repeats=5):
+    timings = []
+    for _ in range(repeats):
+        start = time.perf_counter()
+        subprocess.run([executable, "--parse-only", path], capture_output=True, check=True)
+        timings.append(time.perf_counter() - start)
+    return min(timings)
+
+def main():
+    statements = int(sys.argv[1]) if len(sys.argv) > 1 else 20000
+    count = int(sys.argv[2]) if len(sys.argv) > 2 else 100
+    executable = os.path.join(os.path.dirname(__file__), "../build/paraCL")
+
+    if not os.path.isfile(executable) or not os.access(executable, os.X_OK):
+        print(f"File '{executable}' not found or not executable")
+        sys.exit(1)
+
+    with tempfile.TemporaryDirectory() as workdir:
+        prologue = make_prologue(statements)
+        with open(os.path.join(workdir, "prologue.pcl"), "w") as prologue_file:
+            prologue_file.write(prologue)
+        program_name = os.path.join(workdir, "program.pcl")
+
+        pasted = [prologue + make_body(n, statements - 1) for n in range(count)]
+        imported = ['import "prologue.pcl";\n' + make_body(n, statements - 1) for n in range(count)]
+
+        socket_path = os.path.join(workdir, "paraCL.sock")
+        server = subprocess.Popen([executable, "--serve", socket_path, f"--cache-size={count * 2}"],
+                                  stderr=subprocess.DEVNULL)
+        try:
+            while not os.path.exists(socket_path):
+                time.sleep(0.01)
+
+            pasted_time, pasted_outputs = serve_all(socket_path, pasted, program_name)
+            imported_time, imported_outputs = serve_all(socket_path, imported, program_name)
+            assert pasted_outputs == imported_outputs
+        finally:
+            server.terminate()
+            server.wait()
+
+        print(f"{count} distinct programs sharing a prologue of {statements} statements through the server")
+        print(f"  pasted   : {pasted_time:8.3f} s")
+        print(f"  imported : {imported_time:8.3f} s ({pasted_time / imported_time:.1f}x)")
+
+        modules = os.cpu_count() or 4
+        modules = min(max(modules, 2), 8)
+        module_names = []
+        for m in range(modules):
+            module_names.append(f"module{m}.pcl")
+            with open(os.path.join(workdir, module_names[-1]), "w") as module_file:
+                module_file.write(make_prologue(statements, f"m{m}_"))
+        with open(os.path.join(workdir, "imports.pcl"), "w") as program_file:
+            program_file.write("".join(f'import "{name}";\n' for name in module_names))
+        with open(os.path.join(workdir, "all.pcl"), "w") as program_file:
+            program_file.write("".join(make_prologue(statements, f"m{m}_") for m in range(modules)))
+
+        print(f"parsing {modules} modules of {statements} statements in one process (best of 5)")
+        sequential = parse_time(executable, os.path.join(workdir, "all.pcl"))
+        parallel = parse_time(executable, os.path.join(workdir, "imports.pcl"))
+        print(f"  pasted into one file : {sequential:8.3f} s")
+        print(f"  imported             : {parallel:8.3f} s ({sequential / parallel:.1f}x)")
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,112 @@
+import os
+import socket
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+#   Compares end-to-end latency of a small repeated program run
+#     - as a new process              : paraCL <file>
+#     - through the thin client       : paraCL --client <socket> <file>
+#     - over the socket directly      : frames sent from this script, no process startup at all
+#   against a server started by this script (paraCL --serve <socket>).
+#
+#   usage: python3 server_latency.py [runs]
+
+PROGRAM = """
+n = ?;
+a = 0;
+b = 1;
+i = 0;
+while (i < n)
+{
+    print a;
+    t = a + b;
+    a = b;
+    b = t;
+    i = i + 1;
+}
+"""
+INPUT = "20\n"
+
+def send_frame(sock, kind, payload):
+    sock.sendall(kind + struct.pack(">I", len(payload)) + payload)
+
+def receive_exact(sock, size):
+    data = b""
+    while len(data) < size:
+        chunk = sock.recv(size - len(data))
+        if not chunk:
+            raise ConnectionError("server closed the connection")
+        data += chunk
+    return data
+
+def socket_request(socket_path, program):
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as sock:
+        sock.connect(socket_path)
+        send_frame(sock, b"T", program.encode())
+        send_frame(sock, b"I", INPUT.encode())
+        send_frame(sock, b"E", b"")
+        output = b""
+        while True:
+            header = receive_exact(sock, 5)
+            payload = receive_exact(sock, struct.unpack(">I", header[1:])[0])
+            if header[:1] == b"O":
+                output += payload
+            elif header[:1] == b"X":
+                return output.decode()
+
+def measure(run, runs):
+    run()  #  warm up, fills the server cache
+    timings = []
+    for _ in range(runs):
+        start = time.perf_counter()
+        run()
+        timings.append(time.perf_counter() - start)
+    timings.sort()
+    return timings[len(timings) // 2], timings[int(len(timings) * 0.9)]
+
+def main():
+    runs = int(sys.argv[1]) if len(sys.argv) > 1 else 200
+    executable = os.path.join(os.path.dirname(__file__), "../build/paraCL")
+
+    if not os.path.isfile(executable) or not os.access(executable, os.X_OK):
+        print(f"File '{executable}' not found or not executable")
+        sys.exit(1)
+
+    with tempfile.TemporaryDirectory() as workdir:
+        program_path = os.path.join(workdir, "fib.pcl")
+        socket_path = os.path.join(workdir, "paraCL.sock")
+        with open(program_path, "w") as program_file:
+            program_file.write(PROGRAM)
+
+        server = subprocess.Popen([executable, "--serve", socket_path], stderr=subprocess.DEVNULL)
+        try:
+            while not os.path.exists(socket_path):
+                time.sleep(0.01)
+
+            expected = subprocess.run([executable, program_path], input=INPUT, text=True,
+                                      capture_output=True, check=True).stdout
+
+            def fork_exec():
+                subprocess.run([executable, program_path], input=INPUT, text=True, capture_output=True, check=True)
+
+            def thin_client():
+                result = subprocess.run([executable, "--client", socket_path, program_path], input=INPUT,
+                                        text=True, capture_output=True, check=True)
+                assert result.stdout == expected
+
+            def raw_socket():
+                assert socket_request(socket_path, PROGRAM) == expected
+
+            print(f"latency over {runs} runs (median / p90)")
+            for name, run in (("fork+exec", fork_exec), ("thin client", thin_client), ("raw socket", raw_socket)):
+                median, p90 = measure(run, runs)
+                print(f"  {name:>11}: {median * 1e6:8.0f} us / {p90 * 1e6:8.0f} us")
+        finally:
+            server.terminate()
+            server.wait()
+
+if __name__ == "__main__":
+    main()
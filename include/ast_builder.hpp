@@ -26,5 +26,10 @@ namespace ast
             assert(astBuffer_.back());
             return static_cast<NodeType*>((astBuffer_.back()).get());
         }
+
+        void clear() { astBuffer_.clear(); }
+
+        //  copies trees of another builder into this one, see Cloner
+        Cloner make_cloner(ExecutionContext* context) { return Cloner(astBuffer_, context); }
     };
 }  // namespace ast
\ No newline at end of file
@@ -0,0 +1,34 @@
+//-------------------------------------------------------------------------------------------------
+//
+//  Checkpoints : the program is run with an explicit stack of scope/if/while frames, so at any
+//  loop iteration boundary the whole execution state - variable values, the position in nested
+//  statements, the consumed input and the output so far - can be written to a snapshot file
+//  and a later run can resume from it.
+//
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "node.hpp"
+
+namespace ast
+{
+    struct CheckpointOptions
+    {
+        std::size_t everySteps = 0;               //  loop iterations between checkpoints, 0 for none
+        std::chrono::seconds everySeconds{0};     //  time between checkpoints, 0 for none
+        std::string file;                         //  where checkpoints are written
+        std::string restoreFile;                  //  snapshot to resume from, empty to start anew
+        std::uint64_t programHash = 0;            //  a snapshot is restored into the same program only
+    };
+
+    //  executes the program the way CurrentScopeNode::execute() does, writing a checkpoint as often
+    //  as requested; checkpoint writing problems are reported to diagnostics and do not stop the run
+    void execute_with_checkpoints(CurrentScopeNode* root, ExecutionContext& context,
+                                  const CheckpointOptions& options, std::ostream& diagnostics);
+}   //  namespace ast
@@ -0,0 +1,23 @@
+//-------------------------------------------------------------------------------------------------
+//
+//  Content hash of program texts (FNV-1a), used to recognize the same program again
+//
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace utils
+{
+    inline std::uint64_t content_hash(std::string_view text)
+    {
+        std::uint64_t hash = 14695981039346656037ull;
+        for(const char c : text)
+        {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+}   //  namespace utils
@@ -8,8 +8,12 @@
 #include <algorithm>
 #include <cassert>
 #include <iostream>
+#include <memory>
+#include <optional>
 #include <sstream>
+#include <stdexcept>
 #include <stack>
+#include <string>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -18,20 +22,40 @@
 #include "node.hpp"
 #include "lexer.hpp"
 #include "ast_builder.hpp"
+#include "checkpoint.hpp"
+#include "module.hpp"
+#include "partial_evaluator.hpp"
+#include "pratt_parser.hpp"
+#include "scalar_evolution.hpp"
 #include "pcl_grammar.tab.hh"
 
 namespace yy
 {
+    enum class Frontend
+    {
+        BISON,
+        FAST,
+        FAST_STRICT  //  the fast frontend without the fallback, for testing it
+    };
+
     class Driver final
     {
         bool isExecutable_ = true;
+        Frontend frontend_ = Frontend::BISON;
         Lexer lexer_;
         ast::Builder astBuilder_;
         ast::CurrentScopeNode* ast_ = nullptr;
         std::vector<CurrentScopeNode*> scopeStorage; 
+        std::istream* input_ = nullptr;
+        std::ostream* diagnostics_ = &std::cerr;
+        ast::ExecutionContext context_;
+        std::optional<ast::CheckpointOptions> checkpoints_;
+        modules::ImportOrigin importOrigin_;
+        std::vector<modules::Dependency> dependencies_;  //  imported files
 
     public :
         Driver() = default;
+        Driver(const Frontend frontend) : frontend_(frontend) {}
         
         parser::token_type yylex(parser::location_type* yylloc, parser::semantic_type* yyval)
         {
@@ -47,22 +71,66 @@ namespace yy
                 yyval->emplace<std::string>(lexer_.YYText());
                 return tokenType; 
             }
+            if (tokenType == yy::parser::token_type::STRING)
+            {
+                yyval->emplace<std::string>(string_literal_value(lexer_.YYText()));
+                return tokenType;
+            }
             return tokenType;
         }
 
         void set_input_stream(std::istream& inputStream)
         {
             assert(inputStream);
+            input_ = &inputStream;
             lexer_.switch_streams(&inputStream, &std::cout);
         }
 
+        void set_diagnostics_stream(std::ostream& diagnostics)
+        {
+            diagnostics_ = &diagnostics;
+            lexer_.set_diagnostics_stream(diagnostics);
+        }
+
+        std::ostream& diagnostics() { return *diagnostics_; }
+
+        //  streams used by print and input statements when the program is executed
+        void set_io_streams(std::istream& in, std::ostream& out)
+        {
+            context_.in = &in;
+            context_.out = &out;
+        }
+
+        ast::ExecutionContext* get_context() { return &context_; }
+
         bool parse()
         {
+            if(frontend_ != Frontend::BISON)
+                return parse_fast();
+
             parser parser(this);
             bool res = parser.parse();
             return !res;
         }
 
+        //  imports of the program are resolved against origin
+        void set_import_origin(modules::ImportOrigin origin) { importOrigin_ = std::move(origin); }
+        const modules::ImportOrigin& get_import_origin() const { return importOrigin_; }
+
+        //  compiles the modules the source imports on other threads while the program is parsed,
+        //  source is the text of the input stream
+        void prefetch_imports(const std::string& source)
+        {
+            modules::prefetch(source, importOrigin_, frontend_);
+        }
+
+        //  makes an instance of the module in the current scope, returns null and sets error
+        //  if the module cannot be imported (see module.cpp)
+        ImportNode* import_module(const std::string& path, std::string& error);
+
+        const std::vector<modules::Dependency>& get_dependencies() const { return dependencies_; }
+        Frontend get_frontend() const noexcept { return frontend_; }
+
         parser::location_type& get_current_location() { return lexer_.get_current_location(); }
 
         void set_ast_root(CurrentScopeNode* curScope)
@@ -71,6 +139,24 @@ namespace yy
             ast_ = curScope;
         }
 
+        CurrentScopeNode* get_ast_root() const { return ast_; }
+
+        //  copy of the parsed program with a tree and an execution context of its own, copies of
+        //  one program can run at the same time
+        std::unique_ptr<Driver> instantiate() const
+        {
+            auto instance = std::make_unique<Driver>(frontend_);
+            instance->isExecutable_ = isExecutable_;
+            instance->importOrigin_ = importOrigin_;
+            instance->dependencies_ = dependencies_;
+            if(isExecutable_ && ast_)
+            {
+                ast::Cloner cloner = instance->astBuilder_.make_cloner(&instance->context_);
+                instance->ast_ = cloner(ast_);
+            }
+            return instance;
+        }
+
         const int get_current_line() const noexcept { return lexer_.get_current_line(); }
         const int get_current_column() const noexcept { return lexer_.get_current_column(); }
 
@@ -124,14 +210,106 @@ namespace yy
             return make_node<NodeType>(args ...);
         }
 
+        //  execution goes through the slower checkpointing executor when checkpoints are requested
+        void set_checkpoint_options(const ast::CheckpointOptions& options) { checkpoints_ = options; }
+
         void execute()
         {
             assert(ast_);
-            ast_->execute();
+            if(checkpoints_)
+                ast::execute_with_checkpoints(ast_, context_, *checkpoints_, *diagnostics_);
+            else
+                ast_->execute();
+        }
+
+        //  replaces the counting loops of a parsed program by their closed forms
+        void fold_loops()
+        {
+            if(!isExecutable_ || !ast_)
+                return;
+            ast::fold_counting_loops(ast_, astBuilder_);
+        }
+
+        //  precomputes the input independent prefix of a parsed program, stepBudget limits the
+        //  loop iterations spent on it
+        void partially_evaluate(const std::size_t stepBudget)
+        {
+            if(!isExecutable_ || !ast_)
+                return;
+            ast::PartialEvaluator evaluator(astBuilder_, context_, stepBudget);
+            evaluator.run(ast_);
+        }
+
+    private :
+        //  the fast frontend handles well-formed programs only; anything it cannot accept silently
+        //  is reparsed from the beginning by the bison parser to get the usual diagnostics, unless
+        //  the frontend is strict
+        bool parse_fast()
+        {
+            assert(input_);
+            const std::istream::pos_type start = input_->tellg();
+            if(start != std::istream::pos_type(-1))
+            {
+                std::ostringstream lexDiagnostics;  //  and reports about imported modules
+                std::ostream* diagnostics = diagnostics_;
+                set_diagnostics_stream(lexDiagnostics);
+                PrattParser pratt(this, lexer_);
+                const bool accepted = pratt.parse();
+                set_diagnostics_stream(*diagnostics);
+
+                if(accepted && lexDiagnostics.tellp() == 0)
+                    return true;
+                if(frontend_ == Frontend::FAST_STRICT)
+                    throw std::runtime_error(lexDiagnostics.str() + "the fast frontend did not accept the program");
+
+                scopeStorage.clear();
+                dependencies_.clear();
+                ast_ = nullptr;
+                astBuilder_.clear();
+                input_->clear();
+                input_->seekg(start);
+                lexer_.restart(*input_);
+            }
+            else if(frontend_ == Frontend::FAST_STRICT)
+                throw std::runtime_error("the fast frontend cannot reparse the input stream");
+
+            parser parser(this);
+            bool res = parser.parse();
+            return !res;
+        }
+
+        static std::string string_literal_value(const std::string& literal)
+        {
+            assert(literal.size() >= 2);
+            return literal.substr(1, literal.size() - 2);  //  without quotes
         }
 
 #if 0  //  will be implemented later
         void print_ast() {....}
 #endif    
     };
+
+    //  executes a parsed program the way the command line does, returns the exit status
+    inline int run_program(Driver& driver, const bool parseOnly = false)
+    {
+        if(!driver.is_executable())
+        {
+            driver.diagnostics() << "syntax analysis completed with errors" << std::endl;
+            driver.diagnostics() << "program execution terminated" << std::endl;
+            return 0;
+        }
+        if(parseOnly)
+            return 0;
+
+        try
+        {
+            driver.execute();
+        }
+        catch(std::exception& exptn)
+        {
+            driver.diagnostics() << exptn.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
 }   //  namespace yy
\ No newline at end of file
@@ -18,6 +18,8 @@ namespace errorreport
             else if (buffer == "ELSE"    || buffer == "ELSE,")    { buffer = "keyword 'else',"; }
             else if (buffer == "WHILE"   || buffer == "WHILE,")   { buffer = "keyword 'while',"; }
             else if (buffer == "INPUT"   || buffer == "INPUT,")   { buffer = "keyword '?',"; }
+            else if (buffer == "IMPORT"  || buffer == "IMPORT,")  { buffer = "keyword 'import',"; }
+            else if (buffer == "STRING"  || buffer == "STRING,")  { buffer = "string,"; }
             else if (buffer == "ID"      || buffer == "ID,")      { buffer = "identifier,"; }
             else if (buffer == "NUMBER"  || buffer == "NUMBER,")  { buffer = "integer number,"; }
             else if (buffer == "LEQUAL"  || buffer == "LEQUAL,")  { buffer = "'<=',"; }
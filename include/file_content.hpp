@@ -0,0 +1,32 @@
+//-------------------------------------------------------------------------------------------------
+//
+//  Whole content of a file, read for the server and for imported modules
+//
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace utils
+{
+    //  returns false if the file cannot be read or is not a regular file (a directory opens as an
+    //  empty stream)
+    inline bool read_file(const std::string& fileName, std::string& content)
+    {
+        std::error_code error;
+        if(!std::filesystem::is_regular_file(fileName, error))
+            return false;
+        std::ifstream file(fileName, std::ios::binary);
+        if(!file)
+            return false;
+        std::ostringstream buffer;
+        buffer << file.rdbuf();
+        if(file.bad())
+            return false;
+        content = buffer.str();
+        return true;
+    }
+}   //  namespace utils
@@ -10,6 +10,7 @@ namespace yy
   class Lexer final : public yyFlexLexer
   {
       parser::location_type currentLocation_;
+      std::ostream* diagnostics_ = &std::cerr;
   
   public:
       void update_current_location()
@@ -33,6 +34,17 @@ namespace yy
       const int get_current_line() const noexcept { return currentLocation_.end.line; }
       const int get_current_column() const noexcept { return currentLocation_.end.column; }
 
+      //  start over from the beginning of the given stream (used to reparse after the fast frontend)
+      void restart(std::istream& inputStream)
+      {
+        switch_streams(&inputStream, &std::cout);
+        yylineno = 1;
+        currentLocation_ = parser::location_type{};
+      }
+
+      void set_diagnostics_stream(std::ostream& diagnostics) { diagnostics_ = &diagnostics; }
+      std::ostream& diagnostics() { return *diagnostics_; }
+
       int yylex();
   };
   
@@ -76,6 +88,7 @@ namespace yy
     else if (curr_value == "else")  return yy::parser::token_type::ELSE;
     else if (curr_value == "while") return yy::parser::token_type::WHILE;
     else if (curr_value == "?")     return yy::parser::token_type::INPUT;
+    else if (curr_value == "import") return yy::parser::token_type::IMPORT;
     else return yy::parser::token_type::ERROR;
   }
 
@@ -85,6 +98,12 @@ namespace yy
     return yy::parser::token_type::ID;
   }
 
+  inline int process_string(const std::string& text) {
+    std::string curr_lexem = "string";
+    std::string curr_value = text;
+    return yy::parser::token_type::STRING;
+  }
+
   inline int process_separator(const std::string& text) {
     std::string curr_lexem = "separator";
     std::string curr_value = text;
@@ -0,0 +1,84 @@
+//-------------------------------------------------------------------------------------------------
+//
+//  Modules : every file named by an import statement is compiled separately into a unit, a
+//  template tree kept in a process wide cache keyed by the content hash of the file. Importers
+//  get their own copy of the template, so a module shared by many programs is parsed once.
+//  The imports of a file are found by a quick scan before it is parsed and compiled on other
+//  threads meanwhile.
+//
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace yy
+{
+    class Driver;
+    enum class Frontend;
+}
+
+namespace modules
+{
+    constexpr std::uint64_t MISSING_FILE = 0;  //  hash recorded for an import that cannot be read
+
+    //  a file a program was compiled from, with its content hash at that time
+    struct Dependency
+    {
+        std::string path;
+        std::uint64_t hash;
+    };
+
+    //  what the imports of a file being compiled are resolved against
+    struct ImportOrigin
+    {
+        std::string directory = ".";     //  relative imports are resolved from here
+        std::vector<std::string> chain;  //  files being compiled, the importing ones first
+        const void* unit = nullptr;      //  cache entry of the unit being compiled, if any
+    };
+
+    struct Unit
+    {
+        std::string path;
+        std::string diagnostics;                 //  parser output for the module
+        std::unique_ptr<yy::Driver> driver;      //  template tree, null if parsing was aborted
+        std::vector<Dependency> dependencies;    //  the module file and everything it imports
+
+        ~Unit();
+
+        bool is_valid() const noexcept;
+    };
+
+    enum class LoadStatus
+    {
+        LOADED,
+        CANNOT_OPEN,
+        CIRCULAR
+    };
+
+    struct Lookup
+    {
+        LoadStatus status;
+        std::shared_ptr<const Unit> unit;
+    };
+
+    std::string resolve(const std::string& path, const ImportOrigin& origin);
+
+    //  origin of a program read from the file
+    ImportOrigin file_origin(const std::string& fileName);
+
+    //  compiles the module or takes it from the cache, waits if it is being compiled elsewhere
+    Lookup load_unit(const std::string& resolvedPath, const ImportOrigin& origin, yy::Frontend frontend);
+
+    //  starts compiling the modules imported by the source on other threads; the cache owns these
+    //  compilations, an importer waits for the unit only when its parse gets to the import
+    void prefetch(const std::string& source, const ImportOrigin& origin, yy::Frontend frontend);
+
+    void set_unit_cache_capacity(std::size_t capacity);
+
+    //  true if none of the files has changed since they were compiled
+    bool is_up_to_date(const std::vector<Dependency>& dependencies);
+}   //  namespace modules
@@ -6,12 +6,18 @@
 #pragma once
 
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <memory>
 #include <vector>
 #include <type_traits>
 #include <string>
+#include <unordered_map>
+#include <utility>
 
 namespace ast
 {
@@ -41,6 +47,101 @@ namespace ast
         OR
     };
 
+//-------------------------------------------------------------------------------------------------
+//      EXECUTION CONTEXT
+    //  thrown when a limited run (see ExecutionContext::stepsLeft) makes too many loop iterations
+    struct StepBudgetExceeded {};
+
+    //  state of one program shared by the nodes that talk to the outside world
+    struct ExecutionContext
+    {
+        static constexpr std::size_t UNLIMITED = std::numeric_limits<std::size_t>::max();
+
+        std::istream* in = &std::cin;
+        std::ostream* out = &std::cout;
+        std::size_t stepsLeft = UNLIMITED;  //  loop iterations allowed, limited at compile time only
+
+        //  called by a run every checkInterval loop iterations (see set_check), throws to stop
+        //  the run; set by the server to give up programs whose client has gone
+        std::function<void()> check;
+        std::size_t checkInterval = UNLIMITED;
+
+        void set_check(std::function<void()> newCheck, const std::size_t interval)
+        {
+            check = std::move(newCheck);
+            checkInterval = interval;
+            stepsLeft = interval;
+        }
+
+        void count_step()
+        {
+            if(stepsLeft == UNLIMITED)
+                return;
+            if(stepsLeft == 0)
+                run_check();
+            --stepsLeft;
+        }
+
+        //  iterations made at once by a loop computed in closed form
+        void count_steps(const std::uint64_t steps)
+        {
+            if(stepsLeft == UNLIMITED)
+                return;
+            if(steps > stepsLeft)
+            {
+                run_check();
+                return;
+            }
+            stepsLeft -= steps;
+        }
+
+    private:
+        void run_check()
+        {
+            if(!check)
+                throw StepBudgetExceeded{};
+            check();
+            stepsLeft = checkInterval;
+        }
+    };
+
+//-------------------------------------------------------------------------------------------------
+//      CLONING
+    class INode;
+
+    //  deep copy of a tree into another node buffer (see Builder::make_cloner) : nodes shared
+    //  inside the tree (variables, scopes) are copied once, nodes talking to the outside world
+    //  are attached to the execution context of the new owner
+    class Cloner final
+    {
+        std::vector<std::unique_ptr<INode>>& buffer_;
+        ExecutionContext* context_;
+        std::unordered_map<const INode*, INode*> copies_;
+
+    public:
+        Cloner(std::vector<std::unique_ptr<INode>>& b, ExecutionContext* c) : buffer_(b), context_(c) {}
+
+        template <typename NodeType>
+        NodeType* operator()(const NodeType* node) { return node? node->clone(*this) : nullptr; }
+
+        template <typename NodeType, class... Args>
+        NodeType* make(Args&&... args)
+        {
+            buffer_.emplace_back(std::make_unique<NodeType>(args ...));
+            return static_cast<NodeType*>(buffer_.back().get());
+        }
+
+        ExecutionContext* context() const noexcept { return context_; }
+
+        INode* find_copy(const INode* original) const
+        {
+            auto iter = copies_.find(original);
+            return iter == copies_.end()? nullptr : iter->second;
+        }
+
+        void remember_copy(const INode* original, INode* copy) { copies_.emplace(original, copy); }
+    };
+
 //-------------------------------------------------------------------------------------------------
 //      NODES       
     class INode
@@ -48,6 +149,11 @@ namespace ast
     public :
         INode() = default;
         virtual ~INode() {}
+
+        //  direct subnodes, for analyses walking the tree
+        virtual std::vector<INode*> get_children() const { return {}; }
+
+        virtual INode* clone(Cloner& c) const = 0;
     };
 
     class StatementINode : public INode
@@ -55,6 +161,7 @@ namespace ast
     public:
         StatementINode() : INode{} {}
         virtual void execute() = 0;
+        StatementINode* clone(Cloner& c) const override = 0;
     };
 
     class ExpressionINode : public INode
@@ -62,6 +169,7 @@ namespace ast
     public:
         ExpressionINode() : INode{} {}
         virtual int execute() = 0;    
+        ExpressionINode* clone(Cloner& c) const override = 0;
     };
 
     class NumberNode final : public ExpressionINode
@@ -76,12 +184,14 @@ namespace ast
 
         void set_value(const int n) { number_ = n; }
         int get_value() { return number_; } 
+
+        NumberNode* clone(Cloner& c) const override { return c.make<NumberNode>(number_); }
     };
 
     class VariableNode final : public ExpressionINode
     {
         std::string id_;
-        int value_;
+        int value_ = 0;
 
     public:
         VariableNode(const std::string i) : ExpressionINode{}, id_(i) { }
@@ -90,12 +200,23 @@ namespace ast
         
         std::string get_id() const { return id_; } 
         void set_value(const int v) { value_ = v; } 
+
+        VariableNode* clone(Cloner& c) const override
+        {
+            if(INode* copy = c.find_copy(this))
+                return static_cast<VariableNode*>(copy);
+            VariableNode* copy = c.make<VariableNode>(id_);
+            copy->value_ = value_;
+            c.remember_copy(this, copy);
+            return copy;
+        }
     };
 
     class CurrentScopeNode : public StatementINode
     {
         std::map<std::string, VariableNode*> context_;  //  symbol table for current scope
         std::vector<StatementINode*> curScope_;
+        std::vector<CurrentScopeNode*> imports_;  //  module scopes imported here, latest last
 
     public:
         CurrentScopeNode() : StatementINode{} {}
@@ -103,24 +224,48 @@ namespace ast
         void add_to_context(VariableNode* var) 
         { 
             assert(var);
+            if(context_.find(var->get_id()) == context_.end() && is_declared(var->get_id()))
+                return;  //  a variable of an imported module stays in its module scope
             context_.insert({var->get_id(), var});
             assert(context_.find(var->get_id()) != context_.end());
             assert(context_.find(var->get_id())->second == var);
         }        
 
+        //  own symbols shadow the ones of imported modules
         bool is_declared(const std::string id) const 
         {  
-            if(context_.find(id) == context_.end()) 
-                return false;
-            return true;
+            if(context_.find(id) != context_.end()) 
+                return true;
+            for(auto iter = imports_.rbegin(); iter != imports_.rend(); ++iter)
+                if((*iter)->is_declared(id))
+                    return true;
+            return false;
         }
 
         VariableNode* get_variable(std::string id)
         {
             auto iter = context_.find(id);
-            assert(iter != context_.end());
-            return iter->second;
+            if(iter != context_.end())
+                return iter->second;
+            for(auto module = imports_.rbegin(); module != imports_.rend(); ++module)
+                if((*module)->is_declared(id))
+                    return (*module)->get_variable(id);
+            assert(false && "variable is not declared");
+            return nullptr;
+        }
+
+        void add_import(CurrentScopeNode* module)
+        {
+            assert(module);
+            imports_.push_back(module);
         }
+
+        const std::map<std::string, VariableNode*>& get_declared_variables() const { return context_; }
+        const std::vector<CurrentScopeNode*>& get_imports() const { return imports_; }
+
+        std::vector<StatementINode*>& get_statements() { return curScope_; }
+
+        std::vector<INode*> get_children() const override { return {curScope_.begin(), curScope_.end()}; }
         
         void add_statement(StatementINode* s) 
         { 
@@ -138,6 +283,21 @@ namespace ast
                 stmnt->execute();
             }
         }
+
+        CurrentScopeNode* clone(Cloner& c) const override
+        {
+            if(INode* copy = c.find_copy(this))
+                return static_cast<CurrentScopeNode*>(copy);
+            CurrentScopeNode* copy = c.make<CurrentScopeNode>();
+            c.remember_copy(this, copy);
+            for(auto&& [id, var] : context_)
+                copy->context_.emplace(id, c(var));
+            for(auto&& stmnt : curScope_)
+                copy->curScope_.push_back(c(stmnt));
+            for(auto&& module : imports_)
+                copy->imports_.push_back(c(module));
+            return copy;
+        }
     };
 
     class ExpressionWrapper final : public StatementINode
@@ -147,6 +307,9 @@ namespace ast
     public:
         ExpressionWrapper(ExpressionINode* e) : StatementINode{}, expr_(e) { }
         void execute() override {  assert(expr_) ; expr_->execute(); }
+        ExpressionINode* get_expression() const { return expr_; }
+        std::vector<INode*> get_children() const override { return {expr_}; }
+        ExpressionWrapper* clone(Cloner& c) const override { return c.make<ExpressionWrapper>(c(expr_)); }
     };
     
     class StatementWrapper final : public StatementINode
@@ -156,6 +319,10 @@ namespace ast
     public:
         StatementWrapper(StatementINode* s) : StatementINode{}, stmnt_(s) { }
         void execute() override {  assert(stmnt_) ; stmnt_->execute(); }
+        StatementINode* get_statement() const { return stmnt_; }
+        void set_statement(StatementINode* s) { assert(s); stmnt_ = s; }
+        std::vector<INode*> get_children() const override { return {stmnt_}; }
+        StatementWrapper* clone(Cloner& c) const override { return c.make<StatementWrapper>(c(stmnt_)); }
     };
 
     class EmptyStatement final : public StatementINode
@@ -163,6 +330,7 @@ namespace ast
     public:
         EmptyStatement() : StatementINode{} {}
         void execute() override { return; }
+        EmptyStatement* clone(Cloner& c) const override { return c.make<EmptyStatement>(); }
     };
 
     class AlgebraicExprWrapper final : public ExpressionINode
@@ -176,6 +344,11 @@ namespace ast
             assert(expr_);
             return expr_->execute();
         }
+
+        ExpressionINode* get_expression() const { return expr_; }
+
+        std::vector<INode*> get_children() const override { return {expr_}; }
+        AlgebraicExprWrapper* clone(Cloner& c) const override { return c.make<AlgebraicExprWrapper>(c(expr_)); }
     };
 
     class LogicExprNode final : public ExpressionINode
@@ -192,6 +365,12 @@ namespace ast
             const int exprResult = expr_->execute();
             return (op_ == LogicOpType::NOT)? !exprResult : exprResult;
         }
+
+        ExpressionINode* get_expression() const { return expr_; }
+        LogicOpType get_operation() const { return op_; }
+
+        std::vector<INode*> get_children() const override { return {expr_}; }
+        LogicExprNode* clone(Cloner& c) const override { return c.make<LogicExprNode>(c(expr_), op_); }
     };
 
     class ArithmExprNode final : public ExpressionINode
@@ -208,6 +387,12 @@ namespace ast
             const int exprResult = expr_->execute();
             return (op_ == ArithmOpType::UMINUS)? -exprResult : exprResult;
         }
+
+        ExpressionINode* get_expression() const { return expr_; }
+        ArithmOpType get_operation() const { return op_; }
+
+        std::vector<INode*> get_children() const override { return {expr_}; }
+        ArithmExprNode* clone(Cloner& c) const override { return c.make<ArithmExprNode>(c(expr_), op_); }
     };
 
     template <typename Type> 
@@ -269,6 +454,17 @@ namespace ast
                 throw std::runtime_error("impossible case during executing a binary logic operation"); 
             }        
         }
+
+        ExpressionINode* get_left() const { return leftExpr_; }
+        ExpressionINode* get_right() const { return rightExpr_; }
+        OpType get_operation() const { return binOp_; }
+
+        std::vector<INode*> get_children() const override { return {leftExpr_, rightExpr_}; }
+
+        BinOpNode* clone(Cloner& c) const override
+        {
+            return c.make<BinOpNode>(c(leftExpr_), c(rightExpr_), binOp_);
+        }
     };
 
     class IfExpressionNode final : public StatementINode
@@ -301,22 +497,55 @@ namespace ast
                     elseScope_->execute();
             }
         }
+
+        ExpressionINode* get_condition() const { return expr_; }
+        StatementWrapper* get_if_scope() const { return ifScope_; }
+        StatementWrapper* get_else_scope() const { return elseScope_; }
+
+        std::vector<INode*> get_children() const override
+        {
+            if(!elseScope_)
+                return {expr_, ifScope_};
+            return {expr_, ifScope_, elseScope_};
+        }
+
+        IfExpressionNode* clone(Cloner& c) const override
+        {
+            return c.make<IfExpressionNode>(c(expr_), c(ifScope_), c(elseScope_));
+        }
     };
 
     class WhileExpressionNode final : public StatementINode
     {
         ExpressionINode* expr_ = nullptr;
         StatementWrapper* whileScope_ = nullptr;
+        ExecutionContext* context_ = nullptr;
 
     public:
-        WhileExpressionNode(ExpressionINode* e, StatementWrapper* s) : StatementINode{}, 
-                                                                       expr_(e), whileScope_(s) {}
+        WhileExpressionNode(ExpressionINode* e, StatementWrapper* s, ExecutionContext* c) : StatementINode{}, 
+                                                                                            expr_(e), whileScope_(s),
+                                                                                            context_(c) {}
         void execute() override 
         { 
             assert(expr_);
             assert(whileScope_);
+            assert(context_);
             while(expr_->execute())
+            {
+                context_->count_step();
                 whileScope_->execute(); 
+            }
+        }
+
+        ExpressionINode* get_condition() const { return expr_; }
+        StatementWrapper* get_body() const { return whileScope_; }
+        ExecutionContext* get_context() const { return context_; }
+
+        std::vector<INode*> get_children() const override { return {expr_, whileScope_}; }
+
+        WhileExpressionNode* clone(Cloner& c) const override
+        {
+            return c.make<WhileExpressionNode>(c(expr_), c(whileScope_), c.context());
         }
     };
 
@@ -336,46 +565,127 @@ namespace ast
             var_->set_value(value);
             return var_->execute();
         }
+
+        VariableNode* get_variable() const { return var_; }
+        ExpressionINode* get_expression() const { return expr_; }
+
+        std::vector<INode*> get_children() const override { return {var_, expr_}; }
+        AssignExpressionNode* clone(Cloner& c) const override { return c.make<AssignExpressionNode>(c(var_), c(expr_)); }
     };
 
     class PrintNode final : public ExpressionINode
     {
         ExpressionINode* expr_ = nullptr;
+        ExecutionContext* context_ = nullptr;
 
     public:
-        PrintNode(ExpressionINode* e) : ExpressionINode{}, expr_(e) {}
+        PrintNode(ExpressionINode* e, ExecutionContext* c) : ExpressionINode{}, expr_(e), context_(c) {}
         
         int execute() 
         { 
             assert(expr_);
+            assert(context_);
             int prValue = expr_->execute();
-            std::cout << prValue << std::endl;
+            *context_->out << prValue << std::endl;
             return prValue; 
         }
+
+        std::vector<INode*> get_children() const override { return {expr_}; }
+        PrintNode* clone(Cloner& c) const override { return c.make<PrintNode>(c(expr_), c.context()); }
     };
     
     class InputNode final : public ExpressionINode
     {
         NumberNode* value_ = nullptr;
+        ExecutionContext* context_ = nullptr;
 
     public:
-        InputNode(NumberNode* n) : ExpressionINode{}, value_(n) {}
+        InputNode(NumberNode* n, ExecutionContext* c) : ExpressionINode{}, value_(n), context_(c) {}
         
         int execute() override
         {
             assert(value_);
+            assert(context_);
+            std::istream& in = *context_->in;
             int number;
-            std::cin >> number;
-            if(std::cin.fail())
+            in >> number;
+            if(in.fail())
             {
                 std::string buffer;
-                std::cin.clear();
-                std::cin >> buffer;
+                in.clear();
+                in >> buffer;
                 throw std::runtime_error("runtime error: incorrect input, unexpected '"
                                          + buffer + "', expected integer number");
             }
             value_->set_value(number);
             return value_->get_value();
         }
+
+        std::vector<INode*> get_children() const override { return {value_}; }
+        InputNode* clone(Cloner& c) const override { return c.make<InputNode>(c(value_), c.context()); }
+    };
+
+    //  input independent prefix of a program evaluated at compile time : restores the variables
+    //  it computed, prints its output and fails the way the prefix failed, if it did
+    class PrecomputedNode final : public StatementINode
+    {
+        std::vector<std::pair<VariableNode*, int>> values_;
+        std::string output_;
+        std::string error_;
+        ExecutionContext* context_ = nullptr;
+
+    public:
+        PrecomputedNode(std::vector<std::pair<VariableNode*, int>> v, std::string o, std::string e,
+                        ExecutionContext* c) : StatementINode{}, values_(std::move(v)), output_(std::move(o)),
+                                               error_(std::move(e)), context_(c) {}
+
+        void execute() override
+        {
+            assert(context_);
+            for(auto&& [var, value] : values_)
+                var->set_value(value);
+
+            *context_->out << output_ << std::flush;
+            if(!error_.empty())
+                throw std::runtime_error(error_);
+        }
+
+        std::vector<INode*> get_children() const override
+        {
+            std::vector<INode*> children;
+            for(auto&& value : values_)
+                children.push_back(value.first);
+            return children;
+        }
+
+        PrecomputedNode* clone(Cloner& c) const override
+        {
+            std::vector<std::pair<VariableNode*, int>> values;
+            for(auto&& [var, value] : values_)
+                values.emplace_back(c(var), value);
+            return c.make<PrecomputedNode>(std::move(values), output_, error_, c.context());
+        }
+    };
+
+    //  import "file.pcl"; - runs the module, an instance of a separately compiled unit,
+    //  in its own module scope; the scope is imported into the scope of the statement, so the
+    //  module variables are visible after it
+    class ImportNode final : public StatementINode
+    {
+        CurrentScopeNode* module_ = nullptr;
+
+    public:
+        ImportNode(CurrentScopeNode* m) : StatementINode{}, module_(m) {}
+
+        void execute() override
+        {
+            assert(module_);
+            module_->execute();
+        }
+
+        CurrentScopeNode* get_module() const { return module_; }
+
+        std::vector<INode*> get_children() const override { return {module_}; }
+        ImportNode* clone(Cloner& c) const override { return c.make<ImportNode>(c(module_)); }
     };
 }   //  namespace ast
\ No newline at end of file
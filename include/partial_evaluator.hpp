@@ -0,0 +1,108 @@
+//-------------------------------------------------------------------------------------------------
+//
+//  Partial evaluator - executes the leading top level statements that do not read input at
+//  compile time and replaces them with one PrecomputedNode holding their output, the resulting
+//  variable values and the runtime error they raised, if any. Loop iterations are limited by a
+//  step budget; the statement that exhausts it is left to run at runtime.
+//
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "node.hpp"
+#include "ast_builder.hpp"
+
+namespace ast
+{
+    class PartialEvaluator final
+    {
+        Builder& builder_;
+        ExecutionContext& context_;
+        std::size_t stepBudget_;
+
+    public:
+        PartialEvaluator(Builder& b, ExecutionContext& c, const std::size_t budget) : builder_(b), context_(c),
+                                                                                      stepBudget_(budget) {}
+
+        void run(CurrentScopeNode* root)
+        {
+            assert(root);
+            std::vector<StatementINode*>& statements = root->get_statements();
+
+            std::ostringstream output;
+            std::ostream* runtimeOutput = context_.out;
+            context_.out = &output;
+            context_.stepsLeft = stepBudget_;
+
+            std::size_t evaluated = 0;
+            std::string error;
+            for(; evaluated < statements.size() && !reads_input(statements[evaluated]); ++evaluated)
+            {
+                const std::vector<std::pair<VariableNode*, int>> before = snapshot(root);
+                const std::streampos outputBefore = output.tellp();
+                try
+                {
+                    statements[evaluated]->execute();
+                }
+                catch(StepBudgetExceeded&)  //  too expensive, leave this statement to runtime
+                {
+                    for(auto&& [var, value] : before)
+                        var->set_value(value);
+                    output.str(output.str().substr(0, static_cast<std::size_t>(outputBefore)));
+                    break;
+                }
+                catch(std::exception& exptn)  //  the program fails here whatever the input is
+                {
+                    error = exptn.what();
+                    ++evaluated;
+                    break;
+                }
+            }
+
+            context_.out = runtimeOutput;
+            context_.stepsLeft = ExecutionContext::UNLIMITED;
+
+            if(evaluated == 0)
+                return;
+
+            auto precomputed = builder_.make_node<PrecomputedNode>(snapshot(root), output.str(), error, &context_);
+            statements.erase(statements.begin(), statements.begin() + evaluated);
+            statements.insert(statements.begin(), precomputed);
+        }
+
+    private:
+        static bool reads_input(const INode* node)
+        {
+            assert(node);
+            if(dynamic_cast<const InputNode*>(node))
+                return true;
+            for(auto&& child : node->get_children())
+                if(reads_input(child))
+                    return true;
+            return false;
+        }
+
+        //  only top level variables, including the ones of imported modules, outlive a statement,
+        //  nested ones are assigned before every use
+        static std::vector<std::pair<VariableNode*, int>> snapshot(const CurrentScopeNode* root)
+        {
+            std::vector<std::pair<VariableNode*, int>> values;
+            add_to_snapshot(root, values);
+            return values;
+        }
+
+        static void add_to_snapshot(const CurrentScopeNode* scope, std::vector<std::pair<VariableNode*, int>>& values)
+        {
+            for(auto&& [id, var] : scope->get_declared_variables())
+                values.emplace_back(var, var->execute());
+            for(auto&& module : scope->get_imports())
+                add_to_snapshot(module, values);
+        }
+    };
+}   //  namespace ast
@@ -0,0 +1,63 @@
+//-------------------------------------------------------------------------------------------------
+//
+//  Hand-written frontend : recursive descent for statements and Pratt parsing for expressions.
+//  It accepts exactly the language of pcl_grammar.y and builds the same AST through the same
+//  Driver scope and declaration logic. It never reports anything itself : on any diagnostic
+//  (lexical or syntax error, undeclared variable, bad literal, module that cannot be imported)
+//  parse() returns false and the driver reparses the input with the bison parser, which produces
+//  the usual diagnostics.
+//
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+#include <string>
+
+#include "node.hpp"
+#include "lexer.hpp"
+
+namespace yy
+{
+    class Driver;
+
+    class PrattParser final
+    {
+        struct Token
+        {
+            parser::token_type type;
+            std::string text;  //  only kept for identifiers, numbers and strings (without quotes)
+        };
+
+        Driver* driver_ = nullptr;
+        Lexer& lexer_;
+        Token current_;
+        Token next_;
+        bool hasNext_ = false;
+
+    public:
+        PrattParser(Driver* driver, Lexer& lexer) : driver_(driver), lexer_(lexer) {}
+
+        bool parse();
+
+    private:
+        //  grammar
+        void statements();
+        ast::StatementWrapper* stmnt_wrapper();
+        ast::StatementINode* substmnt();
+        ast::StatementWrapper* scope_wrapper();
+        ast::CurrentScopeNode* scope();
+        ast::IfExpressionNode* if_expression();
+        ast::WhileExpressionNode* while_expression();
+        ast::ImportNode* import();
+        ast::ExpressionINode* expression();
+        ast::ExpressionINode* algebraic_expression(const int minPrecedence);
+        ast::ExpressionINode* unary_expression();
+        ast::ExpressionINode* subexpr();
+
+        //  token stream
+        parser::token_type current() const { return current_.type; }
+        parser::token_type lookahead();
+        std::string advance();
+        void expect(const parser::token_type type);
+        void read_token(Token& tok);
+    };
+}   //  namespace yy
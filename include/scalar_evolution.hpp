@@ -0,0 +1,88 @@
+//-------------------------------------------------------------------------------------------------
+//
+//  Scalar evolution : a while loop whose body only assigns polynomials of the variables (no
+//  print, input, branches, nested loops, division or remainder) and whose condition compares
+//  a counter changing by a loop invariant step with a loop invariant bound is replaced by a
+//  node computing its final variable values in closed form. Arithmetic wraps modulo 2^32 like
+//  the interpreter does, so polynomial recurrences become one linear map on the monomials they
+//  need, raised to the trip count. Whenever the trip count is not known exactly at runtime the
+//  original loop is executed instead.
+//
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "node.hpp"
+#include "ast_builder.hpp"
+
+namespace ast
+{
+    //  polynomial with coefficients wrapping modulo 2^32 over the variables of a loop
+    struct Polynomial
+    {
+        using Monomial = std::vector<std::uint8_t>;  //  exponent of every variable of the loop
+
+        std::map<Monomial, std::uint32_t> terms;  //  no zero coefficients
+
+        std::uint32_t evaluate(const std::vector<std::uint32_t>& values) const;
+    };
+
+    struct ClosedForm
+    {
+        std::vector<VariableNode*> variables;  //  every variable of the loop, the monomial order
+        //  monomials of the assigned variables the loop needs, states[0] is the constant 1
+        std::vector<Polynomial::Monomial> states;
+        //  state after an iteration = transition * state before; the entries depend on the
+        //  variables the loop does not assign only, transition[row] lists nonzero (column, entry)
+        std::vector<std::vector<std::pair<std::size_t, Polynomial>>> transition;
+        std::vector<std::pair<std::size_t, std::size_t>> results;  //  assigned variable, its state
+
+        //  the loop runs while counter op bound, counter grows by step every iteration
+        Polynomial counter;
+        Polynomial step;
+        Polynomial bound;
+        LogicOpType op;
+    };
+
+    class ClosedFormLoopNode final : public StatementINode
+    {
+        WhileExpressionNode* loop_ = nullptr;  //  runs when the closed form does not apply
+        ClosedForm form_;
+        ExecutionContext* context_ = nullptr;
+
+    public:
+        ClosedFormLoopNode(WhileExpressionNode* l, ClosedForm f, ExecutionContext* c) : StatementINode{}, loop_(l),
+                                                                                         form_(std::move(f)), context_(c) {}
+
+        void execute() override;
+
+        //  sets the final variable values and returns true if the closed form applies to the
+        //  current values, otherwise does nothing; the original loop is left to the caller
+        bool execute_closed_form();
+
+        WhileExpressionNode* get_loop() const { return loop_; }
+
+        //  iterations the loop makes from the given variable values, none if they are not known exactly
+        std::optional<std::uint64_t> trip_count(const std::vector<std::uint32_t>& values) const;
+
+        std::vector<INode*> get_children() const override { return {loop_}; }
+
+        ClosedFormLoopNode* clone(Cloner& c) const override
+        {
+            ClosedForm form = form_;
+            for(auto&& var : form.variables)
+                var = c(var);
+            return c.make<ClosedFormLoopNode>(c(loop_), std::move(form), c.context());
+        }
+    };
+
+    //  replaces every loop of the tree that has a closed form
+    void fold_counting_loops(INode* root, Builder& builder);
+}   //  namespace ast
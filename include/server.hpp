@@ -0,0 +1,35 @@
+//-------------------------------------------------------------------------------------------------
+//
+//  Persistent paraCL server : accepts programs over a Unix domain socket, keeps parsed programs
+//  in an LRU cache keyed by content hash and runs requests on a pool of worker threads.
+//  The thin client speaking the same protocol lives here as well.
+//
+//-------------------------------------------------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+#include "driver.hpp"
+
+namespace server
+{
+    struct ServerOptions
+    {
+        std::string socketPath;
+        yy::Frontend frontend = yy::Frontend::BISON;
+        std::size_t workers = 0;      //  0 means one per hardware thread
+        std::size_t cacheSize = 64;   //  programs kept in the cache
+        std::size_t partialEvalBudget = 0;  //  loop iterations precomputed per program, 0 means none
+        bool foldLoops = false;             //  counting loops of every program are computed in closed form
+    };
+
+    //  runs until the process is terminated, returns only if the socket cannot be set up
+    int serve(const ServerOptions& options);
+
+    //  sends the program text and the whole input to the server, prints what comes back and
+    //  returns the exit status of the remote run
+    int run_client(const std::string& socketPath, const std::string& fileName,
+                   std::istream& input, std::ostream& output, std::ostream& errors);
+}   //  namespace server
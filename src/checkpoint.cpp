@@ -0,0 +1,538 @@
+//-------------------------------------------------------------------------------------------------
+//
+//  Snapshot format, all numbers little endian :
+//      magic "PCLCKPT1" | program hash u64 | consumed input bytes u64
+//      | variable count u32 | values i32...        (variables in tree order)
+//      | frame count u32 | (kind u8, index u32)... (from the root scope to the innermost loop)
+//      | output size u64 | output bytes
+//
+//  A snapshot is written by a forked child from its copy of the interpreter memory, the
+//  interpreter goes on at once. It is written to "<file>.tmp" and renamed over the previous one.
+//
+//-------------------------------------------------------------------------------------------------
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <typeinfo>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "checkpoint.hpp"
+#include "scalar_evolution.hpp"
+
+namespace
+{
+    using namespace ast;
+
+    constexpr char MAGIC[] = "PCLCKPT1";
+    constexpr std::size_t MAGIC_SIZE = sizeof(MAGIC) - 1;
+    constexpr std::size_t CLOCK_CHECK_INTERVAL = 256;  //  loop iterations between clock reads
+
+//-------------------------------------------------------------------------------------------------
+//      STREAMS
+    //  forwards characters of the program input and counts the consumed ones
+    class CountingInputBuf final : public std::streambuf
+    {
+        std::streambuf* source_;
+        std::uint64_t consumed_ = 0;
+
+    public:
+        CountingInputBuf(std::streambuf* s, const std::uint64_t consumed) : source_(s), consumed_(consumed) {}
+
+        std::uint64_t consumed() const noexcept { return consumed_; }
+
+    protected:
+        int_type underflow() override { return source_->sgetc(); }
+
+        int_type uflow() override
+        {
+            const int_type c = source_->sbumpc();
+            if(!traits_type::eq_int_type(c, traits_type::eof()))
+                ++consumed_;
+            return c;
+        }
+    };
+
+    //  forwards the program output and keeps a copy of it for snapshots
+    class RecordingOutputBuf final : public std::streambuf
+    {
+        std::streambuf* target_;
+        std::string written_;
+
+    public:
+        RecordingOutputBuf(std::streambuf* t, std::string written) : target_(t), written_(std::move(written)) {}
+
+        const std::string& written() const noexcept { return written_; }
+
+    protected:
+        int_type overflow(const int_type c) override
+        {
+            if(traits_type::eq_int_type(c, traits_type::eof()))
+                return traits_type::not_eof(c);
+            written_.push_back(traits_type::to_char_type(c));
+            return target_->sputc(traits_type::to_char_type(c));
+        }
+
+        std::streamsize xsputn(const char* s, const std::streamsize n) override
+        {
+            written_.append(s, n);
+            return target_->sputn(s, n);
+        }
+
+        int sync() override { return target_->pubsync(); }
+    };
+
+//-------------------------------------------------------------------------------------------------
+//      SERIALIZATION
+    void put_u32(std::string& buffer, const std::uint32_t value)
+    {
+        for(int byte = 0; byte < 4; ++byte)
+            buffer.push_back(static_cast<char>(value >> (8 * byte)));
+    }
+
+    void put_u64(std::string& buffer, const std::uint64_t value)
+    {
+        for(int byte = 0; byte < 8; ++byte)
+            buffer.push_back(static_cast<char>(value >> (8 * byte)));
+    }
+
+    class SnapshotReader final
+    {
+        const std::string& data_;
+        std::size_t pos_ = 0;
+
+    public:
+        SnapshotReader(const std::string& d) : data_(d) {}
+
+        std::string bytes(const std::uint64_t size)
+        {
+            if(size > data_.size() - pos_)
+                throw std::runtime_error("damaged checkpoint");
+            std::string result = data_.substr(pos_, size);
+            pos_ += size;
+            return result;
+        }
+
+        std::uint32_t u32() { return static_cast<std::uint32_t>(number(4)); }
+        std::uint64_t u64() { return number(8); }
+        std::uint8_t u8() { return static_cast<std::uint8_t>(number(1)); }
+
+        bool at_end() const noexcept { return pos_ == data_.size(); }
+
+    private:
+        std::uint64_t number(const int size)
+        {
+            const std::string raw = bytes(size);
+            std::uint64_t value = 0;
+            for(int byte = size - 1; byte >= 0; --byte)
+                value = (value << 8) | static_cast<unsigned char>(raw[byte]);
+            return value;
+        }
+    };
+
+//-------------------------------------------------------------------------------------------------
+//      EXECUTOR
+    enum class PlanKind : std::uint8_t
+    {
+        SCOPE,
+        IF,
+        WHILE,
+        LEAF,   //  any other statement, executed at once
+        FOLDED  //  loop with a closed form (--fold-loops), its original loop runs when that does not apply
+    };
+
+    //  statement tree with wrappers removed and node types resolved, built once before the run
+    struct Plan
+    {
+        PlanKind kind;
+        StatementINode* node;
+        ExpressionINode* condition = nullptr;   //  IF and WHILE
+        std::vector<Plan> children;             //  SCOPE : statements, IF : branches, WHILE : body,
+                                                //  FOLDED : the original loop
+    };
+
+    //  position in a plan, index means
+    //      SCOPE : statements started
+    //      IF    : 1 for the if branch, 2 for the else branch
+    //      FOLDED: 1 while the original loop runs
+    //      WHILE : 1 while the body runs, 0 before the condition
+    struct Frame
+    {
+        const Plan* plan;
+        std::uint32_t index;
+    };
+
+    template <typename NodeType>
+    bool is(const INode* node) { return typeid(*node) == typeid(NodeType); }
+
+    Plan make_plan(StatementINode* stmnt)
+    {
+        while(is<StatementWrapper>(stmnt) || is<ImportNode>(stmnt))
+        {
+            if(is<ImportNode>(stmnt))  //  the module scope runs in place of the import
+                stmnt = static_cast<ImportNode*>(stmnt)->get_module();
+            else
+                stmnt = static_cast<StatementWrapper*>(stmnt)->get_statement();
+        }
+
+        if(is<CurrentScopeNode>(stmnt))
+        {
+            Plan plan{PlanKind::SCOPE, stmnt, nullptr, {}};
+            for(auto&& child : static_cast<CurrentScopeNode*>(stmnt)->get_statements())
+                plan.children.push_back(make_plan(child));
+            return plan;
+        }
+        if(is<IfExpressionNode>(stmnt))
+        {
+            auto branch = static_cast<IfExpressionNode*>(stmnt);
+            Plan plan{PlanKind::IF, stmnt, branch->get_condition(), {}};
+            plan.children.push_back(make_plan(branch->get_if_scope()));
+            if(branch->get_else_scope())
+                plan.children.push_back(make_plan(branch->get_else_scope()));
+            return plan;
+        }
+        if(is<WhileExpressionNode>(stmnt))
+        {
+            auto loop = static_cast<WhileExpressionNode*>(stmnt);
+            Plan plan{PlanKind::WHILE, stmnt, loop->get_condition(), {}};
+            plan.children.push_back(make_plan(loop->get_body()));
+            return plan;
+        }
+        if(is<ClosedFormLoopNode>(stmnt))  //  so that checkpoints are taken in the loop it falls back to
+        {
+            Plan plan{PlanKind::FOLDED, stmnt, nullptr, {}};
+            plan.children.push_back(make_plan(static_cast<ClosedFormLoopNode*>(stmnt)->get_loop()));
+            return plan;
+        }
+        return {PlanKind::LEAF, stmnt, nullptr, {}};
+    }
+
+    class CheckpointingExecutor final
+    {
+        ExecutionContext& context_;
+        const CheckpointOptions& options_;
+        std::ostream& diagnostics_;
+
+        Plan plan_;
+        std::vector<VariableNode*> variables_;  //  every variable of the program, in tree order
+        std::vector<Frame> stack_;
+
+        std::size_t stepsSinceCheckpoint_ = 0;
+        std::chrono::steady_clock::time_point lastCheckpoint_ = std::chrono::steady_clock::now();
+        pid_t writer_ = -1;  //  child writing the previous checkpoint
+        bool failureReported_ = false;
+
+    public:
+        CheckpointingExecutor(CurrentScopeNode* root, ExecutionContext& c, const CheckpointOptions& o,
+                              std::ostream& d) : context_(c), options_(o), diagnostics_(d), plan_(make_plan(root))
+        {
+            std::unordered_set<INode*> visited;
+            collect_variables(root, visited);
+        }
+
+        ~CheckpointingExecutor() { wait_for_writer(false); }
+
+        void run()
+        {
+            std::uint64_t consumed = 0;
+            std::string output;
+            if(options_.restoreFile.empty())
+                stack_.push_back({&plan_, 0});
+            else
+                restore(consumed, output);
+
+            CountingInputBuf input(context_.in->rdbuf(), consumed);
+            RecordingOutputBuf recorder(context_.out->rdbuf(), std::move(output));
+            std::istream countedIn(&input);
+            std::ostream recordedOut(&recorder);
+
+            std::istream* runtimeIn = context_.in;
+            std::ostream* runtimeOut = context_.out;
+            context_.in = &countedIn;
+            context_.out = &recordedOut;
+            try
+            {
+                execute_frames(input, recorder);
+            }
+            catch(...)
+            {
+                context_.in = runtimeIn;
+                context_.out = runtimeOut;
+                throw;
+            }
+            context_.in = runtimeIn;
+            context_.out = runtimeOut;
+        }
+
+    private:
+        void execute_frames(const CountingInputBuf& input, const RecordingOutputBuf& recorder)
+        {
+            while(!stack_.empty())
+            {
+                Frame& frame = stack_.back();
+                const Plan& plan = *frame.plan;
+                switch(plan.kind)
+                {
+                    case PlanKind::SCOPE:
+                        if(frame.index == plan.children.size())
+                            stack_.pop_back();
+                        else
+                            enter(plan.children[frame.index++]);
+                        break;
+
+                    case PlanKind::IF:
+                    case PlanKind::FOLDED:
+                        stack_.pop_back();  //  the branch or the original loop is over
+                        break;
+
+                    case PlanKind::WHILE:
+                        frame.index = 0;
+                        if(checkpoint_due())
+                            checkpoint(input, recorder);
+
+                        if(!plan.condition->execute())
+                        {
+                            stack_.pop_back();
+                            break;
+                        }
+                        stack_.back().index = 1;
+                        ++stepsSinceCheckpoint_;
+                        enter(plan.children.front());
+                        break;
+
+                    case PlanKind::LEAF:
+                        assert(false && "leaf statements never get a frame");
+                        break;
+                }
+            }
+        }
+
+        void enter(const Plan& plan)
+        {
+            switch(plan.kind)
+            {
+                case PlanKind::SCOPE:
+                case PlanKind::WHILE:
+                    stack_.push_back({&plan, 0});
+                    break;
+
+                case PlanKind::IF:
+                    if(plan.condition->execute())
+                    {
+                        stack_.push_back({&plan, 1});
+                        enter(plan.children[0]);
+                    }
+                    else if(plan.children.size() == 2)
+                    {
+                        stack_.push_back({&plan, 2});
+                        enter(plan.children[1]);
+                    }
+                    break;
+
+                case PlanKind::LEAF:
+                    plan.node->execute();
+                    break;
+
+                case PlanKind::FOLDED:
+                    if(!static_cast<ClosedFormLoopNode*>(plan.node)->execute_closed_form())
+                    {
+                        stack_.push_back({&plan, 1});
+                        enter(plan.children.front());
+                    }
+                    break;
+            }
+        }
+
+        bool checkpoint_due()
+        {
+            if(options_.everySteps)
+                return stepsSinceCheckpoint_ >= options_.everySteps;
+            if(options_.everySeconds.count() == 0 || stepsSinceCheckpoint_ < CLOCK_CHECK_INTERVAL)
+                return false;
+            stepsSinceCheckpoint_ = 0;
+            return std::chrono::steady_clock::now() - lastCheckpoint_ >= options_.everySeconds;
+        }
+
+        void checkpoint(const CountingInputBuf& input, const RecordingOutputBuf& recorder)
+        {
+            stepsSinceCheckpoint_ = 0;
+            lastCheckpoint_ = std::chrono::steady_clock::now();
+            if(!wait_for_writer(true))
+                return;  //  the previous one is still being written, skip this one
+
+            context_.out->flush();
+            const pid_t pid = ::fork();
+            if(pid == 0)
+                ::_exit(write_snapshot(input.consumed(), recorder.written())? 0 : 1);
+            if(pid > 0)
+            {
+                writer_ = pid;
+                return;
+            }
+
+            if(!write_snapshot(input.consumed(), recorder.written()))  //  no child, write it ourselves
+                report_failure();
+        }
+
+        //  returns false if nonBlocking and the writer has not finished yet
+        bool wait_for_writer(const bool nonBlocking)
+        {
+            if(writer_ < 0)
+                return true;
+
+            int status = 0;
+            pid_t result;
+            do
+                result = ::waitpid(writer_, &status, nonBlocking? WNOHANG : 0);
+            while(result < 0 && errno == EINTR);
+
+            if(result == 0)
+                return false;
+            writer_ = -1;
+            if(result < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                report_failure();
+            return true;
+        }
+
+        void report_failure()
+        {
+            if(failureReported_)
+                return;
+            failureReported_ = true;
+            diagnostics_ << "warning: cannot write checkpoint " << options_.file << std::endl;
+        }
+
+        bool write_snapshot(const std::uint64_t consumed, const std::string& output) const
+        {
+            std::string buffer(MAGIC, MAGIC_SIZE);
+            put_u64(buffer, options_.programHash);
+            put_u64(buffer, consumed);
+
+            put_u32(buffer, static_cast<std::uint32_t>(variables_.size()));
+            for(auto&& var : variables_)
+                put_u32(buffer, static_cast<std::uint32_t>(var->execute()));
+
+            put_u32(buffer, static_cast<std::uint32_t>(stack_.size()));
+            for(auto&& frame : stack_)
+            {
+                buffer.push_back(static_cast<char>(frame.plan->kind));
+                put_u32(buffer, frame.index);
+            }
+
+            put_u64(buffer, output.size());
+            buffer += output;
+
+            const std::string temporary = options_.file + ".tmp";
+            {
+                std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+                if(!file.write(buffer.data(), static_cast<std::streamsize>(buffer.size())) || !file.flush())
+                    return false;
+            }
+            return std::rename(temporary.c_str(), options_.file.c_str()) == 0;
+        }
+
+        void restore(std::uint64_t& consumed, std::string& output)
+        {
+            std::ifstream file(options_.restoreFile, std::ios::binary);
+            if(!file)
+                throw std::runtime_error("error: cannot open checkpoint " + options_.restoreFile);
+            std::ostringstream content;
+            content << file.rdbuf();
+            const std::string data = content.str();
+
+            try
+            {
+                SnapshotReader reader(data);
+                if(reader.bytes(MAGIC_SIZE) != MAGIC)
+                    throw std::runtime_error("not a checkpoint");
+                if(reader.u64() != options_.programHash)
+                    throw std::runtime_error("checkpoint of another program or options");
+                consumed = reader.u64();
+
+                if(reader.u32() != variables_.size())
+                    throw std::runtime_error("damaged checkpoint");
+                for(auto&& var : variables_)
+                    var->set_value(static_cast<int>(reader.u32()));
+
+                const std::uint32_t depth = reader.u32();
+                for(std::uint32_t n = 0; n < depth; ++n)
+                {
+                    const std::uint8_t kind = reader.u8();
+                    const std::uint32_t index = reader.u32();
+                    push_restored_frame(static_cast<PlanKind>(kind), index);
+                }
+                if(stack_.empty() || stack_.back().plan->kind != PlanKind::WHILE || stack_.back().index != 0)
+                    throw std::runtime_error("damaged checkpoint");
+
+                output = reader.bytes(reader.u64());
+                if(!reader.at_end())
+                    throw std::runtime_error("damaged checkpoint");
+            }
+            catch(std::runtime_error& exptn)
+            {
+                throw std::runtime_error("error: cannot restore " + options_.restoreFile + ": " + exptn.what());
+            }
+
+            context_.in->ignore(static_cast<std::streamsize>(consumed));
+            if(static_cast<std::uint64_t>(context_.in->gcount()) != consumed)
+                throw std::runtime_error("error: cannot restore " + options_.restoreFile +
+                                         ": the input is shorter than the consumed part");
+            *context_.out << output << std::flush;
+        }
+
+        //  the plan of every frame is found from the frame below it, so a snapshot cannot point
+        //  outside of the tree
+        void push_restored_frame(const PlanKind kind, const std::uint32_t index)
+        {
+            const Plan* plan = &plan_;
+            if(!stack_.empty())
+            {
+                const Frame& parent = stack_.back();  //  the statement, branch or body it runs is index - 1
+                if(parent.index == 0 || parent.index > parent.plan->children.size())
+                    throw std::runtime_error("damaged checkpoint");
+                plan = &parent.plan->children[parent.index - 1];
+            }
+
+            const bool valid = (kind == plan->kind) &&
+                               ((kind == PlanKind::SCOPE && index <= plan->children.size()) ||
+                                (kind == PlanKind::IF && index >= 1 && index <= plan->children.size()) ||
+                                (kind == PlanKind::FOLDED && index == 1) ||
+                                (kind == PlanKind::WHILE && index <= 1));
+            if(!valid)
+                throw std::runtime_error("damaged checkpoint");
+            stack_.push_back({plan, index});
+        }
+
+        void collect_variables(INode* node, std::unordered_set<INode*>& visited)
+        {
+            if(!node || !visited.insert(node).second)
+                return;
+            if(is<VariableNode>(node))
+                variables_.push_back(static_cast<VariableNode*>(node));
+            for(auto&& child : node->get_children())
+                collect_variables(child, visited);
+        }
+    };
+}
+
+namespace ast
+{
+    void execute_with_checkpoints(CurrentScopeNode* root, ExecutionContext& context,
+                                  const CheckpointOptions& options, std::ostream& diagnostics)
+    {
+        assert(root);
+        CheckpointingExecutor executor(root, context, options, diagnostics);
+        executor.run();
+    }
+}   //  namespace ast
@@ -1,35 +1,204 @@
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <sstream>
 #include <vector>
 #include "string"
 
+#include "content_hash.hpp"
 #include "driver.hpp"
 #include "lexer.hpp"
+#include "server.hpp"
 
 int yyFlexLexer::yywrap() { return 1; }
 
+namespace
+{
+    constexpr std::size_t DEFAULT_PARTIAL_EVAL_BUDGET = 1000000;  //  loop iterations
+
+    struct Options
+    {
+        yy::Frontend frontend = yy::Frontend::BISON;
+        bool parseOnly = false;
+        std::string serveSocket;
+        std::string clientSocket;
+        std::size_t workers = 0;
+        std::size_t cacheSize = 64;
+        std::size_t partialEvalBudget = 0;  //  0 means no partial evaluation
+        bool foldLoops = false;
+        std::size_t checkpointSteps = 0;
+        std::size_t checkpointSeconds = 0;
+        std::string checkpointFile;  //  "<program file>.ckpt" by default
+        std::string restoreFile;
+        std::vector<std::string> files;
+        std::vector<std::string> unknown;
+        std::vector<std::string> compileOptions;  //  given, they mean nothing to the client
+        std::vector<std::string> serverOptions;   //  given, they mean nothing without --serve
+    };
+
+    //  options telling how to compile and run programs, the server does that for the client
+    bool is_compile_option(const std::string& arg)
+    {
+        for(auto&& prefix : {"--frontend=", "--parse-only", "--workers=", "--cache-size=", "--partial-eval", "--fold-loops"})
+            if(arg.starts_with(prefix))
+                return true;
+        return false;
+    }
+
+    //  options telling how the server runs, nothing else reads them
+    bool is_server_option(const std::string& arg)
+    {
+        return arg.starts_with("--workers=") || arg.starts_with("--cache-size=");
+    }
+
+    //  parses "<prefix><positive number>"
+    bool parse_count(const std::string& arg, const std::string& prefix, std::size_t& value)
+    {
+        if(!arg.starts_with(prefix))
+            return false;
+        std::string number = arg.substr(prefix.size());
+        if(number.empty() || number.size() > 9 || number.find_first_not_of("0123456789") != std::string::npos)
+            return false;
+        value = std::stoul(number);
+        return value > 0;
+    }
+
+    Options parse_options(int argc, char* argv[])
+    {
+        Options options;
+        for(int n = 1; n < argc; ++n)
+        {
+            std::string arg(argv[n]);
+            if(is_compile_option(arg))
+            {
+                options.compileOptions.push_back(arg);
+            }
+            if(is_server_option(arg))
+            {
+                options.serverOptions.push_back(arg);
+            }
+
+            if(arg == "--frontend=bison")      options.frontend = yy::Frontend::BISON;
+            else if(arg == "--frontend=fast")  options.frontend = yy::Frontend::FAST;
+            else if(arg == "--frontend=fast-strict") options.frontend = yy::Frontend::FAST_STRICT;
+            else if(arg == "--parse-only")     options.parseOnly = true;
+            else if(arg == "--serve"  && n + 1 < argc) options.serveSocket = argv[++n];
+            else if(arg == "--client" && n + 1 < argc) options.clientSocket = argv[++n];
+            else if(parse_count(arg, "--workers=", options.workers));
+            else if(parse_count(arg, "--cache-size=", options.cacheSize));
+            else if(arg == "--fold-loops")     options.foldLoops = true;
+            else if(arg == "--partial-eval")   options.partialEvalBudget = DEFAULT_PARTIAL_EVAL_BUDGET;
+            else if(parse_count(arg, "--partial-eval=", options.partialEvalBudget));
+            else if(arg.starts_with("--checkpoint-every=") && arg.ends_with("s") &&
+                    parse_count(arg.substr(0, arg.size() - 1), "--checkpoint-every=", options.checkpointSeconds));
+            else if(parse_count(arg, "--checkpoint-every=", options.checkpointSteps));
+            else if(arg.starts_with("--checkpoint-file=") && arg.size() > 18) options.checkpointFile = arg.substr(18);
+            else if(arg == "--restore" && n + 1 < argc) options.restoreFile = argv[++n];
+            else if(arg.starts_with("--"))     options.unknown.push_back(arg);
+            else                               options.files.push_back(arg);
+        }
+        return options;
+    }
+
+    bool uses_checkpoints(const Options& options)
+    {
+        return options.checkpointSteps || options.checkpointSeconds || !options.restoreFile.empty();
+    }
+
+    ast::CheckpointOptions checkpoint_options(const Options& options, const std::string& fileName,
+                                              const std::string& source,
+                                              const std::vector<modules::Dependency>& imports)
+    {
+        ast::CheckpointOptions checkpoints;
+        checkpoints.everySteps = options.checkpointSteps;
+        checkpoints.everySeconds = std::chrono::seconds(options.checkpointSeconds);
+        checkpoints.file = options.checkpointFile.empty()? fileName + ".ckpt" : options.checkpointFile;
+        checkpoints.restoreFile = options.restoreFile;
+
+        //  partial evaluation changes the tree, so a snapshot is bound to it as well
+        std::string program = source + "\n--partial-eval=" + std::to_string(options.partialEvalBudget) +
+                              "\n--fold-loops=" + std::to_string(options.foldLoops);
+        for(auto&& module : imports)  //  and so are the modules
+            program += "\n" + module.path + ":" + std::to_string(module.hash);
+        checkpoints.programHash = utils::content_hash(program);
+        return checkpoints;
+    }
+}
+
 int main(int argc, char* argv[])
 {
     try
     {
-        if(argc != 2)
+        Options options = parse_options(argc, argv);
+        if(!options.unknown.empty())
+        {
+            std::cout << "error: " << std::endl;
+            std::cout << "unknown options: ";
+            for(auto&& opt : options.unknown)
+                std::cout << opt << " ";
+            std::cout << std::endl;
+            return 1;
+        }
+        if(uses_checkpoints(options) && (!options.serveSocket.empty() || !options.clientSocket.empty()))
+        {
+            std::cout << "error: " << std::endl;
+            std::cout << "checkpoints are not supported in server mode" << std::endl;
+            return 1;
+        }
+        if(!options.clientSocket.empty() && (!options.serveSocket.empty() || !options.compileOptions.empty()))
+        {
+            std::cout << "error: " << std::endl;
+            std::cout << "options of the server cannot be given to the client: ";
+            if(!options.serveSocket.empty())
+                std::cout << "--serve ";
+            for(auto&& opt : options.compileOptions)
+                std::cout << opt << " ";
+            std::cout << std::endl;
+            return 1;
+        }
+        if(!options.serveSocket.empty() && !options.files.empty())
+        {
+            std::cout << "error: " << std::endl;
+            std::cout << "the server takes no input files, send them with --client: ";
+            for(auto&& file : options.files)
+                std::cout << file << " ";
+            std::cout << std::endl;
+            return 1;
+        }
+        if(options.serveSocket.empty() && !options.serverOptions.empty())
+        {
+            std::cout << "error: " << std::endl;
+            std::cout << "options of the server need --serve: ";
+            for(auto&& opt : options.serverOptions)
+                std::cout << opt << " ";
+            std::cout << std::endl;
+            return 1;
+        }
+        if(!options.serveSocket.empty())
+            return server::serve({options.serveSocket, options.frontend, options.workers, options.cacheSize,
+                                   options.partialEvalBudget, options.foldLoops});
+        if(options.files.size() != 1)
         {  
             std::cout << "error: " << std::endl;
-            switch(argc < 2)
+            switch(options.files.empty())
             {
                 case true:   std::cout << "no input files" << std::endl;
                              break;
 
                 case false:  std::cout << "too many arguments: ";
-                             for(int n = 1; n < argc; ++n)
-                                std::cout << argv[n] << " ";
+                             for(auto&& file : options.files)
+                                std::cout << file << " ";
                              std::cout << std::endl;
                              break; 
             }
             return 1; 
         }
 
-        std::string fileName(argv[1]);
+        std::string fileName(options.files.front());
+        if(!options.clientSocket.empty())
+            return server::run_client(options.clientSocket, fileName, std::cin, std::cout, std::cerr);
+
         std::ifstream InputFile(fileName);
         if (!InputFile)
         {
@@ -38,16 +207,21 @@ int main(int argc, char* argv[])
             return 1;
         }
 
-        yy::Driver driver{};
-        driver.set_input_stream(InputFile);
+        std::string source{std::istreambuf_iterator<char>(InputFile), std::istreambuf_iterator<char>()};
+        std::istringstream programStream(source);
+
+        yy::Driver driver{options.frontend};
+        driver.set_input_stream(programStream);
+        driver.set_import_origin(modules::file_origin(fileName));
+        driver.prefetch_imports(source);
         driver.parse();
-        if(driver.is_executable())
-            driver.execute();
-        else
-        {
-            std::cerr << "syntax analysis completed with errors" << std::endl;
-            std::cerr << "program execution terminated" << std::endl;
-        }
+        if(options.foldLoops && !options.parseOnly)
+            driver.fold_loops();
+        if(options.partialEvalBudget && !options.parseOnly)
+            driver.partially_evaluate(options.partialEvalBudget);
+        if(uses_checkpoints(options))
+            driver.set_checkpoint_options(checkpoint_options(options, fileName, source, driver.get_dependencies()));
+        return yy::run_program(driver, options.parseOnly);
     }
     catch(std::exception& exptn)
     {
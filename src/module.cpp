@@ -0,0 +1,493 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <future>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <system_error>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
+
+#include "content_hash.hpp"
+#include "file_content.hpp"
+#include "driver.hpp"
+#include "module.hpp"
+
+namespace
+{
+    std::string directory_of(const std::string& fileName)
+    {
+        const std::string directory = std::filesystem::path(fileName).parent_path().string();
+        return directory.empty()? "." : directory;
+    }
+
+    bool is_in_chain(const std::string& path, const modules::ImportOrigin& origin)
+    {
+        return std::find(origin.chain.begin(), origin.chain.end(), path) != origin.chain.end();
+    }
+
+    //  the head of the chain is the program itself, it is not a unit of the cache
+    bool is_program(const std::string& path, const modules::ImportOrigin& origin)
+    {
+        return !origin.chain.empty() && origin.chain.front() == path;
+    }
+
+//-------------------------------------------------------------------------------------------------
+//      UNIT CACHE
+    using UnitPtr = std::shared_ptr<const modules::Unit>;
+
+    //  a unit is compiled once per file content; a cache entry exists from the moment somebody
+    //  starts compiling it, so the others wait for that compilation instead of repeating it
+    struct CachedUnit
+    {
+        std::string path;
+        std::string source;
+        std::promise<UnitPtr> promise;
+        std::shared_future<UnitPtr> unit;
+    };
+
+    class UnitCache final
+    {
+        using Entry = std::list<CachedUnit>::iterator;
+
+        //  edge of the wait-for graph of compilations; a deferred one waits for an ancestor of the
+        //  import chain to finish or to wait back for the importer, see wait_for_ancestor_locked
+        struct Wait
+        {
+            const void* unit;
+            bool deferred;
+        };
+
+        //  the edge from a compilation stays in the graph while it waits
+        class Waiting final
+        {
+            UnitCache& cache_;
+            std::unique_lock<std::mutex>& lock_;
+            const void* from_;
+
+        public:
+            Waiting(UnitCache& cache, std::unique_lock<std::mutex>& lock, const void* from, const void* to,
+                    const bool deferred) : cache_(cache), lock_(lock), from_(from)
+            {
+                if(!from_)
+                    return;
+                cache_.waitsFor_[from_] = {to, deferred};
+                cache_.changed_.notify_all();
+            }
+
+            Waiting(const Waiting&) = delete;
+            Waiting& operator=(const Waiting&) = delete;
+
+            ~Waiting()
+            {
+                if(!lock_.owns_lock())
+                    lock_.lock();
+                if(from_)
+                    cache_.waitsFor_.erase(from_);
+            }
+        };
+
+        //  fulfils the promise of a compiled unit on every way out of the compilation, so nobody
+        //  waits for it forever, and wakes up the compilations waiting for an ancestor
+        class Publication final
+        {
+            UnitCache& cache_;
+            CachedUnit& entry_;
+            bool published_ = false;
+
+        public:
+            Publication(UnitCache& cache, CachedUnit& entry) : cache_(cache), entry_(entry) {}
+
+            Publication(const Publication&) = delete;
+            Publication& operator=(const Publication&) = delete;
+
+            ~Publication()
+            {
+                if(!published_)
+                {
+                    try
+                    {
+                        auto unit = std::make_shared<modules::Unit>();
+                        unit->path = entry_.path;
+                        unit->diagnostics = "compilation aborted\n";
+                        entry_.promise.set_value(std::move(unit));
+                    }
+                    catch(...)
+                    {
+                        entry_.promise.set_exception(std::current_exception());
+                    }
+                }
+                std::lock_guard lock(cache_.mutex_);
+                cache_.changed_.notify_all();
+            }
+
+            void publish(UnitPtr unit)
+            {
+                entry_.promise.set_value(std::move(unit));
+                published_ = true;
+            }
+        };
+
+        std::mutex mutex_;
+        std::condition_variable changed_;  //  a unit is compiled or the wait-for graph has grown
+        std::size_t capacity_ = 256;
+        std::list<CachedUnit> lru_;  //  most recently used first
+        std::unordered_multimap<std::uint64_t, Entry> index_;
+        //  units being compiled that wait for another one, the wait-for graph of compilations
+        std::unordered_map<const void*, Wait> waitsFor_;
+        //  compilations started by prefetch; nobody waits for them but an importer, and those the
+        //  importers never got to are joined when the cache goes away
+        std::vector<std::future<void>> background_;
+
+    public:
+        UnitCache() = default;
+        UnitCache(const UnitCache&) = delete;
+        UnitCache& operator=(const UnitCache&) = delete;
+
+        ~UnitCache()
+        {
+            for(;;)
+            {
+                std::vector<std::future<void>> background;
+                {
+                    std::lock_guard lock(mutex_);
+                    background.swap(background_);
+                }
+                if(background.empty())
+                    break;
+                background.clear();  //  waits, they may start others meanwhile
+            }
+        }
+
+        void set_capacity(const std::size_t capacity)
+        {
+            std::lock_guard lock(mutex_);
+            capacity_ = std::max<std::size_t>(capacity, 1);
+        }
+
+        //  ancestor is true if the path is in the import chain of the importer
+        modules::Lookup get(const std::string& path, const std::string& source, const modules::ImportOrigin& origin,
+                            const yy::Frontend frontend, const bool ancestor)
+        {
+            const std::uint64_t hash = key(path, source);
+            std::unique_lock lock(mutex_);
+            if(auto cached = find_locked(hash, path, source))
+            {
+                Entry entry = *cached;
+                if(ancestor)
+                    return wait_for_ancestor_locked(lock, entry, origin.unit);
+
+                std::shared_future<UnitPtr> unit = entry->unit;
+                if(unit.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+                    return {modules::LoadStatus::LOADED, unit.get()};
+
+                //  the compilation waited for may be waiting, through others, for this one
+                if(origin.unit && reaches_locked(&*entry, origin.unit, false))
+                    return {modules::LoadStatus::CIRCULAR, nullptr};
+                Waiting waiting(*this, lock, origin.unit, &*entry, false);
+                lock.unlock();
+                return {modules::LoadStatus::LOADED, unit.get()};
+            }
+
+            //  an ancestor that is not cached any more has finished, it is compiled again like any other
+            Entry entry = insert_locked(hash, path, source);
+            Waiting waiting(*this, lock, origin.unit, &*entry, false);
+            lock.unlock();
+            return {modules::LoadStatus::LOADED, compile(entry, origin, frontend)};
+        }
+
+        //  starts the compilation on another thread unless the unit is known already
+        void start(const std::string& path, const std::string& source, const modules::ImportOrigin& origin,
+                   const yy::Frontend frontend)
+        {
+            const std::uint64_t hash = key(path, source);
+            std::lock_guard lock(mutex_);
+            std::erase_if(background_, [](const std::future<void>& compilation)
+                          { return compilation.wait_for(std::chrono::seconds(0)) == std::future_status::ready; });
+            if(find_locked(hash, path, source))
+                return;
+
+            background_.reserve(background_.size() + 1);
+            Entry entry = insert_locked(hash, path, source);
+            try
+            {
+                background_.push_back(std::async(std::launch::async, [this, entry, origin, frontend]
+                                                 { compile(entry, origin, frontend); }));
+            }
+            catch(std::system_error&)  //  no thread for it, the importer compiles it when it gets there
+            {
+                remove_locked(entry);
+            }
+        }
+
+    private:
+        static std::uint64_t key(const std::string& path, const std::string& source)
+        {
+            return utils::content_hash(path + '\0' + source);
+        }
+
+        std::optional<Entry> find_locked(const std::uint64_t hash, const std::string& path, const std::string& source)
+        {
+            auto [first, last] = index_.equal_range(hash);
+            for(auto iter = first; iter != last; ++iter)
+            {
+                if(iter->second->path != path || iter->second->source != source)
+                    continue;
+                lru_.splice(lru_.begin(), lru_, iter->second);
+                return lru_.begin();
+            }
+            return std::nullopt;
+        }
+
+        Entry insert_locked(const std::uint64_t hash, const std::string& path, const std::string& source)
+        {
+            lru_.emplace_front();
+            Entry entry = lru_.begin();
+            entry->path = path;
+            entry->source = source;
+            entry->unit = entry->promise.get_future().share();
+            index_.emplace(hash, entry);
+            evict_locked();
+            return entry;
+        }
+
+        Entry remove_locked(const Entry entry)
+        {
+            auto [first, last] = index_.equal_range(key(entry->path, entry->source));
+            for(auto indexed = first; indexed != last; ++indexed)
+            {
+                if(indexed->second == entry)
+                {
+                    index_.erase(indexed);
+                    break;
+                }
+            }
+            return lru_.erase(entry);
+        }
+
+        //  units still being compiled stay, somebody may be waiting for them
+        void evict_locked()
+        {
+            for(auto iter = lru_.end(); lru_.size() > capacity_ && iter != lru_.begin();)
+            {
+                --iter;
+                if(iter->unit.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+                    iter = remove_locked(iter);
+            }
+        }
+
+        //  deferred edges are followed only on behalf of a deferred wait, they may form cycles
+        //  for a moment, so the walk is bounded
+        bool reaches_locked(const void* from, const void* to, const bool throughDeferred) const
+        {
+            for(std::size_t steps = 0; from && steps <= waitsFor_.size(); ++steps)
+            {
+                if(from == to)
+                    return true;
+                auto iter = waitsFor_.find(from);
+                if(iter == waitsFor_.end() || (iter->second.deferred && !throughDeferred))
+                    return false;
+                from = iter->second.unit;
+            }
+            return false;
+        }
+
+        //  the importer is compiled on behalf of an ancestor of the chain, maybe by a prefetch that
+        //  started before the ancestor got to its import statement. The import is circular once the
+        //  ancestor waits, through the others, for the importer; an ancestor that finishes without
+        //  that never got there and is imported like any other unit
+        modules::Lookup wait_for_ancestor_locked(std::unique_lock<std::mutex>& lock, const Entry ancestor,
+                                                 const void* importer)
+        {
+            std::shared_future<UnitPtr> unit = ancestor->unit;
+            Waiting waiting(*this, lock, importer, &*ancestor, true);
+            for(;;)
+            {
+                if(unit.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+                    return {modules::LoadStatus::LOADED, unit.get()};
+                if(reaches_locked(&*ancestor, importer, true))
+                    return {modules::LoadStatus::CIRCULAR, nullptr};
+                changed_.wait(lock);
+            }
+        }
+
+        UnitPtr compile(const Entry entry, const modules::ImportOrigin& importer, const yy::Frontend frontend)
+        {
+            Publication publication(*this, *entry);
+            auto unit = std::make_shared<modules::Unit>();
+            unit->path = entry->path;
+            unit->driver = std::make_unique<yy::Driver>(frontend);
+
+            modules::ImportOrigin origin;
+            origin.directory = directory_of(entry->path);
+            origin.chain = importer.chain;
+            origin.chain.push_back(entry->path);
+            origin.unit = &*entry;
+
+            std::istringstream moduleStream(entry->source);
+            std::ostringstream diagnostics;
+            unit->driver->set_diagnostics_stream(diagnostics);
+            unit->driver->set_input_stream(moduleStream);
+            unit->driver->set_import_origin(origin);
+            try
+            {
+                unit->driver->prefetch_imports(entry->source);
+                unit->driver->parse();
+                unit->dependencies = unit->driver->get_dependencies();
+            }
+            catch(std::exception& exptn)
+            {
+                diagnostics << exptn.what() << std::endl;
+                unit->driver.reset();
+            }
+            unit->diagnostics = diagnostics.str();
+            unit->dependencies.insert(unit->dependencies.begin(), {entry->path, utils::content_hash(entry->source)});
+
+            UnitPtr result = std::move(unit);
+            publication.publish(result);
+            return result;
+        }
+    };
+
+    UnitCache& unit_cache()
+    {
+        static UnitCache cache;
+        return cache;
+    }
+
+    //  paths of the import statements of a source, found without parsing it
+    std::vector<std::string> scan_imports(const std::string& source)
+    {
+        std::vector<std::string> paths;
+        const std::string keyword = "import";
+        for(std::size_t pos = 0; pos < source.size();)
+        {
+            if(source.compare(pos, 2, "//") == 0)
+            {
+                pos = source.find('\n', pos);
+                continue;
+            }
+            const bool wordStart = pos == 0 || !(std::isalnum(static_cast<unsigned char>(source[pos - 1])) ||
+                                                 source[pos - 1] == '_');
+            if(!wordStart || source.compare(pos, keyword.size(), keyword) != 0)
+            {
+                ++pos;
+                continue;
+            }
+
+            pos += keyword.size();
+            while(pos < source.size() && std::isspace(static_cast<unsigned char>(source[pos])))
+                ++pos;
+            if(pos >= source.size() || source[pos] != '"')
+                continue;
+            const std::size_t end = source.find_first_of("\"\n", pos + 1);
+            if(end == std::string::npos || source[end] != '"')
+                continue;
+            paths.push_back(source.substr(pos + 1, end - pos - 1));
+            pos = end + 1;
+        }
+        return paths;
+    }
+}
+
+namespace modules
+{
+    Unit::~Unit() = default;
+
+    bool Unit::is_valid() const noexcept
+    {
+        return driver && driver->is_executable() && driver->get_ast_root();
+    }
+
+    std::string resolve(const std::string& path, const ImportOrigin& origin)
+    {
+        std::filesystem::path resolved(path);
+        if(resolved.is_relative())
+            resolved = std::filesystem::path(origin.directory) / resolved;
+        return resolved.lexically_normal().string();
+    }
+
+    ImportOrigin file_origin(const std::string& fileName)
+    {
+        ImportOrigin origin;
+        const std::string path = resolve(fileName, origin);
+        origin.directory = directory_of(path);
+        origin.chain.push_back(path);
+        return origin;
+    }
+
+    Lookup load_unit(const std::string& resolvedPath, const ImportOrigin& origin, const yy::Frontend frontend)
+    {
+        if(is_program(resolvedPath, origin))
+            return {LoadStatus::CIRCULAR, nullptr};
+
+        std::string source;
+        if(!utils::read_file(resolvedPath, source))
+            return {LoadStatus::CANNOT_OPEN, nullptr};
+        return unit_cache().get(resolvedPath, source, origin, frontend, is_in_chain(resolvedPath, origin));
+    }
+
+    void prefetch(const std::string& source, const ImportOrigin& origin, const yy::Frontend frontend)
+    {
+        for(auto&& path : scan_imports(source))
+        {
+            const std::string resolved = resolve(path, origin);
+            std::string moduleSource;
+            if(is_in_chain(resolved, origin) || !utils::read_file(resolved, moduleSource))
+                continue;  //  reported when the import statement is parsed
+            unit_cache().start(resolved, moduleSource, origin, frontend);
+        }
+    }
+
+    void set_unit_cache_capacity(const std::size_t capacity) { unit_cache().set_capacity(capacity); }
+
+    bool is_up_to_date(const std::vector<Dependency>& dependencies)
+    {
+        for(auto&& dependency : dependencies)
+        {
+            std::string source;
+            const std::uint64_t hash = utils::read_file(dependency.path, source)? utils::content_hash(source) : MISSING_FILE;
+            if(hash != dependency.hash)
+                return false;
+        }
+        return true;
+    }
+}   //  namespace modules
+
+namespace yy
+{
+    ImportNode* Driver::import_module(const std::string& path, std::string& error)
+    {
+        const std::string resolved = modules::resolve(path, importOrigin_);
+        const modules::Lookup lookup = modules::load_unit(resolved, importOrigin_, frontend_);
+        switch(lookup.status)
+        {
+            case modules::LoadStatus::CIRCULAR:     error = "circular import of '" + path + "'";
+                                                    return nullptr;
+
+            case modules::LoadStatus::CANNOT_OPEN:  error = "cannot open module '" + path + "'";
+                                                    dependencies_.push_back({resolved, modules::MISSING_FILE});
+                                                    return nullptr;
+
+            case modules::LoadStatus::LOADED:       break;
+        }
+
+        const modules::Unit& unit = *lookup.unit;
+        dependencies_.insert(dependencies_.end(), unit.dependencies.begin(), unit.dependencies.end());
+        if(!unit.is_valid())
+        {
+            diagnostics() << "in module " << path << ":" << std::endl << unit.diagnostics;
+            error = "module '" + path + "' contains errors";
+            return nullptr;
+        }
+
+        ast::Cloner cloner = astBuilder_.make_cloner(&context_);
+        CurrentScopeNode* module = cloner(unit.driver->get_ast_root());
+        scopeStorage.back()->add_import(module);
+        return make_node<ImportNode>(module);
+    }
+}   //  namespace yy
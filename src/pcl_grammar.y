@@ -15,6 +15,8 @@
 //              statement -> expression_wrapper; 
 //                           | if_expression 
 //                           | while_expression 
+//                           | import;
+//                 import -> import string
 //          if_expression -> if ( expression ) 
 //                             scope_wrapper
 //                           | if ( expression ) 
@@ -118,10 +120,12 @@ namespace yy
     WHILE 
     IF
     ELSE
+    IMPORT
 ;
 
 %token <int> NUMBER
 %token <std::string> ID
+%token <std::string> STRING
 %nterm <EmptyStatement*> empty_statement
 %nterm <NumberNode*> number
 %nterm <CurrentScopeNode*> statements 
@@ -139,6 +143,7 @@ namespace yy
 %nterm <ExpressionINode*> subexpr
 %nterm <IfExpressionNode*> if_expression
 %nterm <WhileExpressionNode*> while_expression
+%nterm <StatementINode*> import
 %nterm <PrintNode*> print
 %nterm <InputNode*> input
 %nterm <AssignExpressionNode*> assignment 
@@ -209,6 +214,7 @@ scope: %empty               {
 statement: expression_wrapper SCOLON  { $$ = $1; }
          | if_expression              { $$ = $1; }
          | while_expression           { $$ = $1; }
+         | import SCOLON              { $$ = $1; }
 ;
 
 if_expression: IF LPAREN expression RPAREN 
@@ -232,7 +238,18 @@ subscope: %empty  {
                     driver->descend_into_scope($$);
                   }
 
-while_expression: WHILE LPAREN expression RPAREN scope_wrapper  { $$ = driver->make_node<WhileExpressionNode>($3, $5); } 
+while_expression: WHILE LPAREN expression RPAREN scope_wrapper  { $$ = driver->make_node<WhileExpressionNode>($3, $5, driver->get_context()); } 
+;
+
+import: IMPORT STRING  { 
+                         std::string error;
+                         $$ = driver->import_module($2, error);
+                         if(!$$)
+                         {
+                             parser::error(@$, error);
+                             $$ = driver->make_node<EmptyStatement>();
+                         }
+                       }
 ;
 
 expression_wrapper: expression  { $$ = driver->make_node<ExpressionWrapper>($1); }
@@ -251,11 +268,11 @@ assignment: variable ASSIGN expression  {
 
 input: INPUT  { 
                 NumberNode* number = driver->make_node<NumberNode>();
-                $$ = driver->make_node<InputNode>(number); 
+                $$ = driver->make_node<InputNode>(number, driver->get_context()); 
               }
 ;
 
-print: PRINT expression  { $$ = driver->make_node<PrintNode>($2); }
+print: PRINT expression  { $$ = driver->make_node<PrintNode>($2, driver->get_context()); }
 ;
 
 algebraic_expression: arithmetic_expression %prec ARITHM  { $$ = $1; }
@@ -394,6 +411,6 @@ namespace yy
           const int line = driver->get_current_line();
           const int column = driver->get_current_column();
           std::string msg = errorreport::prepare_error_message(errorMessage);
-          std::cerr << line << ":" << column << ": " << msg << std::endl;  //  TODO: redesign without guts
+          driver->diagnostics() << line << ":" << column << ": " << msg << std::endl;  //  TODO: redesign without guts
      }
 }  //  namespace yy
\ No newline at end of file
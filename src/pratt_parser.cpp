@@ -0,0 +1,337 @@
+#include <string>
+#include <utility>
+
+#include "driver.hpp"
+#include "pratt_parser.hpp"
+
+namespace
+{
+    //  thrown to abandon the fast parse and hand the program to the bison parser
+    struct FallbackToBison {};
+
+    [[noreturn]] void fallback() { throw FallbackToBison{}; }
+
+    //  binding powers mirror the precedence declarations of pcl_grammar.y
+    int binary_precedence(const yy::parser::token_type type)
+    {
+        using token = yy::parser::token;
+        switch(type)
+        {
+            case token::AND:
+            case token::OR:      return 1;
+            case token::LESS:
+            case token::GREATER:
+            case token::EQUAL:
+            case token::LEQUAL:
+            case token::GEQUAL:
+            case token::NEQUAL:  return 2;
+            case token::MINUS:
+            case token::PLUS:    return 3;
+            case token::DIV:
+            case token::MUL:
+            case token::MOD:     return 4;
+            default:             return 0;
+        }
+    }
+
+    bool is_right_associative(const int precedence) { return precedence == 1 || precedence == 4; }
+}
+
+namespace yy
+{
+    bool PrattParser::parse()
+    {
+        try
+        {
+            read_token(current_);
+            statements();
+            return true;
+        }
+        catch(FallbackToBison&)
+        {
+            return false;
+        }
+        catch(std::out_of_range&)  //  integer literal does not fit, let bison report it in order
+        {
+            return false;
+        }
+    }
+
+//-------------------------------------------------------------------------------------------------
+//      STATEMENTS
+    void PrattParser::statements()
+    {
+        CurrentScopeNode* root = driver_->make_node<CurrentScopeNode>();
+        driver_->descend_into_scope(root);
+
+        while(current() != parser::token::YYEOF)
+            root->add_statement(stmnt_wrapper());
+
+        driver_->set_ast_root(root);
+    }
+
+    StatementWrapper* PrattParser::stmnt_wrapper()
+    {
+        if(current() != parser::token::LCBR)
+            return driver_->make_node<StatementWrapper>(substmnt());
+
+        advance();
+        CurrentScopeNode* curScope = scope();
+        expect(parser::token::RCBR);
+        StatementWrapper* wrapper = driver_->make_node<StatementWrapper>(curScope);
+        driver_->ascend_from_scope();
+        return wrapper;
+    }
+
+    StatementINode* PrattParser::substmnt()
+    {
+        switch(current())
+        {
+            case parser::token::SCOLON: advance();
+                                        return driver_->make_node<StatementWrapper>(driver_->make_node<EmptyStatement>());
+
+            case parser::token::IF:     return driver_->make_node<StatementWrapper>(if_expression());
+
+            case parser::token::WHILE:  return driver_->make_node<StatementWrapper>(while_expression());
+
+            case parser::token::IMPORT: return driver_->make_node<StatementWrapper>(import());
+
+            default:                    break;
+        }
+
+        ExpressionINode* expr = expression();
+        expect(parser::token::SCOLON);
+        StatementINode* stmnt = driver_->make_node<ExpressionWrapper>(expr);
+        return driver_->make_node<StatementWrapper>(stmnt);
+    }
+
+    CurrentScopeNode* PrattParser::scope()
+    {
+        CurrentScopeNode* curScope = driver_->make_node<CurrentScopeNode>();
+        driver_->descend_into_scope(curScope);
+
+        while(current() != parser::token::RCBR)
+        {
+            if(current() == parser::token::YYEOF)
+                fallback();
+            curScope->add_statement(stmnt_wrapper());
+        }
+        return curScope;
+    }
+
+    StatementWrapper* PrattParser::scope_wrapper()
+    {
+        if(current() == parser::token::LCBR)
+            return stmnt_wrapper();
+
+        CurrentScopeNode* subscope = driver_->make_node<CurrentScopeNode>();
+        driver_->descend_into_scope(subscope);
+        subscope->add_statement(substmnt());
+        StatementWrapper* wrapper = driver_->make_node<StatementWrapper>(subscope);
+        driver_->ascend_from_scope();
+        return wrapper;
+    }
+
+    IfExpressionNode* PrattParser::if_expression()
+    {
+        expect(parser::token::IF);
+        expect(parser::token::LPAREN);
+        ExpressionINode* expr = expression();
+        expect(parser::token::RPAREN);
+        StatementWrapper* ifScope = scope_wrapper();
+
+        if(current() != parser::token::ELSE)
+            return driver_->make_node<IfExpressionNode>(expr, ifScope);
+
+        advance();
+        StatementWrapper* elseScope = scope_wrapper();
+        return driver_->make_node<IfExpressionNode>(expr, ifScope, elseScope);
+    }
+
+    WhileExpressionNode* PrattParser::while_expression()
+    {
+        expect(parser::token::WHILE);
+        expect(parser::token::LPAREN);
+        ExpressionINode* expr = expression();
+        expect(parser::token::RPAREN);
+        StatementWrapper* whileScope = scope_wrapper();
+        return driver_->make_node<WhileExpressionNode>(expr, whileScope, driver_->get_context());
+    }
+
+    ImportNode* PrattParser::import()
+    {
+        expect(parser::token::IMPORT);
+        if(current() != parser::token::STRING)
+            fallback();
+        const std::string path = advance();
+        expect(parser::token::SCOLON);
+
+        std::string error;
+        ImportNode* imported = driver_->import_module(path, error);
+        if(!imported)
+            fallback();  //  reported by the bison parser
+        return imported;
+    }
+
+//-------------------------------------------------------------------------------------------------
+//      EXPRESSIONS
+    ExpressionINode* PrattParser::expression()
+    {
+        if(current() == parser::token::PRINT)
+        {
+            advance();
+            return driver_->make_node<PrintNode>(expression(), driver_->get_context());
+        }
+
+        if(current() == parser::token::ID && lookahead() == parser::token::ASSIGN)
+        {
+            VariableNode* var = driver_->make_or_assign<VariableNode>(advance());
+            advance();
+            AssignExpressionNode* assignment = driver_->make_node<AssignExpressionNode>(var, expression());
+            driver_->add_to_context(var);
+            return assignment;
+        }
+
+        return algebraic_expression(1);
+    }
+
+    ExpressionINode* PrattParser::algebraic_expression(const int minPrecedence)
+    {
+        ExpressionINode* left = unary_expression();
+
+        for(;;)
+        {
+            const parser::token_type op = current();
+            const int precedence = binary_precedence(op);
+            if(precedence == 0 || precedence < minPrecedence)
+                return left;
+
+            advance();
+            ExpressionINode* right = algebraic_expression(is_right_associative(precedence)? precedence : precedence + 1);
+
+            using ArithmBinOp = BinOpNode<ast::ArithmOpType>;
+            using LogicBinOp = BinOpNode<ast::LogicOpType>;
+            auto arithm = [&](ast::ArithmOpType t) -> ExpressionINode*
+            {
+                auto expr = driver_->make_node<ArithmBinOp>(left, right, t);
+                return driver_->make_node<ArithmExprNode>(expr);
+            };
+            auto logic = [&](ast::LogicOpType t) -> ExpressionINode*
+            {
+                auto expr = driver_->make_node<LogicBinOp>(left, right, t);
+                return driver_->make_node<LogicExprNode>(expr, t);
+            };
+
+            switch(op)
+            {
+                case parser::token::MINUS:   left = arithm(ast::ArithmOpType::MINUS);  break;
+                case parser::token::PLUS:    left = arithm(ast::ArithmOpType::PLUS);   break;
+                case parser::token::DIV:     left = arithm(ast::ArithmOpType::DIV);    break;
+                case parser::token::MUL:     left = arithm(ast::ArithmOpType::MUL);    break;
+                case parser::token::MOD:     left = arithm(ast::ArithmOpType::MOD);    break;
+                case parser::token::LESS:    left = logic(ast::LogicOpType::LESS);     break;
+                case parser::token::GREATER: left = logic(ast::LogicOpType::GREATER);  break;
+                case parser::token::EQUAL:   left = logic(ast::LogicOpType::EQUAL);    break;
+                case parser::token::LEQUAL:  left = logic(ast::LogicOpType::LEQUAL);   break;
+                case parser::token::GEQUAL:  left = logic(ast::LogicOpType::GEQUAL);   break;
+                case parser::token::NEQUAL:  left = logic(ast::LogicOpType::NEQUAL);   break;
+                case parser::token::AND:     left = logic(ast::LogicOpType::AND);      break;
+                case parser::token::OR:      left = logic(ast::LogicOpType::OR);       break;
+                default:                     fallback();
+            }
+        }
+    }
+
+    //  '!' binds tighter than any binary operator, while unary '-' and '+' only take a subexpr
+    ExpressionINode* PrattParser::unary_expression()
+    {
+        switch(current())
+        {
+            case parser::token::NOT:    advance();
+                                        return driver_->make_node<LogicExprNode>(unary_expression(), ast::LogicOpType::NOT);
+
+            case parser::token::MINUS:  advance();
+                                        return driver_->make_node<ArithmExprNode>(subexpr(), ast::ArithmOpType::UMINUS);
+
+            case parser::token::PLUS:   advance();
+                                        return driver_->make_node<ArithmExprNode>(subexpr(), ast::ArithmOpType::UPLUS);
+
+            default:                    return subexpr();
+        }
+    }
+
+    ExpressionINode* PrattParser::subexpr()
+    {
+        switch(current())
+        {
+            case parser::token::NUMBER: return driver_->make_node<NumberNode>(std::stoi(advance()));
+
+            case parser::token::ID:     {
+                                          VariableNode* var = driver_->find_variable(advance());
+                                          if(!var)
+                                              fallback();  //  not declared in this scope
+                                          return var;
+                                        }
+
+            case parser::token::LPAREN: {
+                                          advance();
+                                          ExpressionINode* expr = expression();
+                                          expect(parser::token::RPAREN);
+                                          return expr;
+                                        }
+
+            case parser::token::INPUT:  {
+                                          advance();
+                                          NumberNode* number = driver_->make_node<NumberNode>();
+                                          return driver_->make_node<InputNode>(number, driver_->get_context());
+                                        }
+
+            default:                    fallback();
+        }
+    }
+
+//-------------------------------------------------------------------------------------------------
+//      TOKEN STREAM
+    parser::token_type PrattParser::lookahead()
+    {
+        if(!hasNext_)
+        {
+            read_token(next_);
+            hasNext_ = true;
+        }
+        return next_.type;
+    }
+
+    //  moves to the next token and returns the text of the consumed one
+    std::string PrattParser::advance()
+    {
+        std::string text = std::move(current_.text);
+        if(hasNext_)
+        {
+            std::swap(current_, next_);
+            hasNext_ = false;
+        }
+        else if(current_.type != parser::token::YYEOF)
+            read_token(current_);
+        return text;
+    }
+
+    void PrattParser::expect(const parser::token_type type)
+    {
+        if(current() != type)
+            fallback();
+        advance();
+    }
+
+    void PrattParser::read_token(Token& tok)
+    {
+        tok.type = static_cast<parser::token_type>(lexer_.yylex());
+        if(tok.type == parser::token::NUMBER || tok.type == parser::token::ID)
+            tok.text = lexer_.YYText();
+        else if(tok.type == parser::token::STRING)
+        {
+            const std::string literal = lexer_.YYText();
+            tok.text = literal.substr(1, literal.size() - 2);
+        }
+    }
+}   //  namespace yy
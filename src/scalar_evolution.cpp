@@ -0,0 +1,483 @@
+#include <bit>
+#include <limits>
+#include <typeinfo>
+#include <unordered_map>
+
+#include "scalar_evolution.hpp"
+
+namespace
+{
+    using ast::ClosedForm;
+    using ast::Polynomial;
+    using Monomial = Polynomial::Monomial;
+
+    //  thrown to leave the loop as it is
+    struct NotClosedForm {};
+
+    constexpr unsigned MAX_DEGREE = 8;        //  of the monomials the loop needs
+    constexpr std::size_t MAX_STATES = 32;    //  size of the transition matrix
+
+    template <typename NodeType>
+    bool is(const ast::INode* node) { return typeid(*node) == typeid(NodeType); }
+
+//-------------------------------------------------------------------------------------------------
+//      POLYNOMIALS
+    std::uint32_t power(std::uint32_t base, unsigned exponent)
+    {
+        std::uint32_t result = 1;
+        for(; exponent; exponent >>= 1, base *= base)
+            if(exponent & 1)
+                result *= base;
+        return result;
+    }
+
+    std::uint32_t evaluate_monomial(const Monomial& monomial, const std::vector<std::uint32_t>& values)
+    {
+        std::uint32_t result = 1;
+        for(std::size_t n = 0; n < monomial.size(); ++n)
+            if(monomial[n])
+                result *= power(values[n], monomial[n]);
+        return result;
+    }
+
+    void add_term(Polynomial& p, const Monomial& monomial, const std::uint32_t coefficient)
+    {
+        if(!coefficient)
+            return;
+        std::uint32_t& sum = p.terms[monomial];
+        sum += coefficient;
+        if(!sum)
+            p.terms.erase(monomial);
+    }
+
+    Polynomial constant(const std::size_t variables, const std::uint32_t value)
+    {
+        Polynomial p;
+        add_term(p, Monomial(variables, 0), value);
+        return p;
+    }
+
+    Polynomial variable(const std::size_t variables, const std::size_t index)
+    {
+        Monomial monomial(variables, 0);
+        monomial[index] = 1;
+        Polynomial p;
+        add_term(p, monomial, 1);
+        return p;
+    }
+
+    Polynomial add(Polynomial a, const Polynomial& b, const std::uint32_t factor = 1)
+    {
+        for(auto&& [monomial, coefficient] : b.terms)
+            add_term(a, monomial, coefficient * factor);
+        return a;
+    }
+
+    Polynomial subtract(const Polynomial& a, const Polynomial& b) { return add(a, b, std::numeric_limits<std::uint32_t>::max()); }
+
+    Polynomial negate(const Polynomial& a) { return subtract(Polynomial{}, a); }
+
+    Polynomial multiply(const Polynomial& a, const Polynomial& b)
+    {
+        Polynomial product;
+        for(auto&& [left, leftCoefficient] : a.terms)
+        {
+            for(auto&& [right, rightCoefficient] : b.terms)
+            {
+                Monomial monomial(left.size());
+                unsigned degree = 0;
+                for(std::size_t n = 0; n < monomial.size(); ++n)
+                {
+                    degree += left[n] + right[n];
+                    monomial[n] = static_cast<std::uint8_t>(left[n] + right[n]);
+                }
+                if(degree > MAX_DEGREE)
+                    throw NotClosedForm{};
+                add_term(product, monomial, leftCoefficient * rightCoefficient);
+            }
+        }
+        return product;
+    }
+
+//-------------------------------------------------------------------------------------------------
+//      MATRICES
+    using Matrix = std::vector<std::uint32_t>;  //  size * size, row major
+
+    Matrix multiply(const Matrix& a, const Matrix& b, const std::size_t size)
+    {
+        Matrix product(size * size, 0);
+        for(std::size_t row = 0; row < size; ++row)
+            for(std::size_t k = 0; k < size; ++k)
+                if(const std::uint32_t factor = a[row * size + k])
+                    for(std::size_t column = 0; column < size; ++column)
+                        product[row * size + column] += factor * b[k * size + column];
+        return product;
+    }
+
+    std::vector<std::uint32_t> apply_matrix(const Matrix& a, const std::vector<std::uint32_t>& vector)
+    {
+        const std::size_t size = vector.size();
+        std::vector<std::uint32_t> result(size, 0);
+        for(std::size_t row = 0; row < size; ++row)
+            for(std::size_t column = 0; column < size; ++column)
+                result[row] += a[row * size + column] * vector[column];
+        return result;
+    }
+
+//-------------------------------------------------------------------------------------------------
+//      ANALYSIS
+    class LoopAnalysis final
+    {
+        std::vector<ast::VariableNode*> variables_;
+        std::unordered_map<const ast::INode*, std::size_t> indices_;
+        std::vector<bool> assigned_;
+        std::vector<Polynomial> values_;  //  of the variables after the part of the body walked so far
+
+    public:
+        ClosedForm analyze(ast::WhileExpressionNode* loop)
+        {
+            collect_variables(loop);
+            assigned_.assign(variables_.size(), false);
+            for(std::size_t n = 0; n < variables_.size(); ++n)
+                values_.push_back(variable(variables_.size(), n));
+
+            ClosedForm form;
+            form.variables = variables_;
+            condition(loop->get_condition(), form);
+            run(loop->get_body());
+            orient(form);
+            make_transition(form);
+            return form;
+        }
+
+    private:
+        void collect_variables(ast::INode* node)
+        {
+            if(is<ast::VariableNode>(node) && indices_.emplace(node, variables_.size()).second)
+                variables_.push_back(static_cast<ast::VariableNode*>(node));
+            for(auto&& child : node->get_children())
+                collect_variables(child);
+        }
+
+        //  a comparison of two polynomials or a polynomial meaning polynomial != 0
+        void condition(ast::ExpressionINode* cond, ClosedForm& form)
+        {
+            form.op = ast::LogicOpType::NEQUAL;
+            if(!is<ast::LogicExprNode>(cond))
+            {
+                form.counter = evaluate(cond, false);
+                form.bound = Polynomial{};
+                return;
+            }
+
+            auto logic = static_cast<ast::LogicExprNode*>(cond);
+            using LogicBinOp = ast::BinOpNode<ast::LogicOpType>;
+            if(!is<LogicBinOp>(logic->get_expression()))
+                throw NotClosedForm{};
+            auto comparison = static_cast<LogicBinOp*>(logic->get_expression());
+            form.op = comparison->get_operation();
+            if(form.op == ast::LogicOpType::AND || form.op == ast::LogicOpType::OR || form.op == ast::LogicOpType::NOT)
+                throw NotClosedForm{};
+            form.counter = evaluate(comparison->get_left(), false);
+            form.bound = evaluate(comparison->get_right(), false);
+        }
+
+        void run(ast::StatementINode* stmnt)
+        {
+            if(is<ast::StatementWrapper>(stmnt))
+                run(static_cast<ast::StatementWrapper*>(stmnt)->get_statement());
+            else if(is<ast::CurrentScopeNode>(stmnt))
+            {
+                for(auto&& child : static_cast<ast::CurrentScopeNode*>(stmnt)->get_statements())
+                    run(child);
+            }
+            else if(is<ast::ExpressionWrapper>(stmnt))
+                evaluate(static_cast<ast::ExpressionWrapper*>(stmnt)->get_expression(), true);
+            else if(!is<ast::EmptyStatement>(stmnt))
+                throw NotClosedForm{};
+        }
+
+        //  value of the expression in terms of the variable values at the start of an iteration
+        Polynomial evaluate(ast::ExpressionINode* expr, const bool assignments)
+        {
+            const std::size_t size = variables_.size();
+            if(is<ast::NumberNode>(expr))
+                return constant(size, static_cast<std::uint32_t>(static_cast<ast::NumberNode*>(expr)->get_value()));
+            if(is<ast::VariableNode>(expr))
+                return values_[indices_.at(expr)];
+            if(is<ast::AlgebraicExprWrapper>(expr))
+                return evaluate(static_cast<ast::AlgebraicExprWrapper*>(expr)->get_expression(), assignments);
+            if(is<ast::ArithmExprNode>(expr))
+            {
+                auto arithm = static_cast<ast::ArithmExprNode*>(expr);
+                Polynomial value = evaluate(arithm->get_expression(), assignments);
+                return arithm->get_operation() == ast::ArithmOpType::UMINUS? negate(value) : value;
+            }
+
+            using ArithmBinOp = ast::BinOpNode<ast::ArithmOpType>;
+            if(is<ArithmBinOp>(expr))
+            {
+                auto binOp = static_cast<ArithmBinOp*>(expr);
+                Polynomial left = evaluate(binOp->get_left(), assignments);
+                Polynomial right = evaluate(binOp->get_right(), assignments);
+                switch(binOp->get_operation())
+                {
+                    case ast::ArithmOpType::PLUS:   return add(left, right);
+                    case ast::ArithmOpType::MINUS:  return subtract(left, right);
+                    case ast::ArithmOpType::MUL:    return multiply(left, right);
+                    default:                        throw NotClosedForm{};  //  division may fail
+                }
+            }
+
+            if(assignments && is<ast::AssignExpressionNode>(expr))
+            {
+                auto assignment = static_cast<ast::AssignExpressionNode*>(expr);
+                Polynomial value = evaluate(assignment->get_expression(), assignments);
+                const std::size_t index = indices_.at(assignment->get_variable());
+                assigned_[index] = true;
+                values_[index] = value;
+                return value;
+            }
+            throw NotClosedForm{};  //  comparisons, print, input
+        }
+
+        bool depends_on_state(const Polynomial& p) const
+        {
+            for(auto&& [monomial, coefficient] : p.terms)
+                for(std::size_t n = 0; n < monomial.size(); ++n)
+                    if(monomial[n] && assigned_[n])
+                        return true;
+            return false;
+        }
+
+        //  the value after one iteration of a polynomial of the values before it
+        Polynomial after_iteration(const Polynomial& p) const
+        {
+            Polynomial result;
+            for(auto&& [monomial, coefficient] : p.terms)
+            {
+                Polynomial term = constant(variables_.size(), coefficient);
+                for(std::size_t n = 0; n < monomial.size(); ++n)
+                    for(unsigned k = 0; k < monomial[n]; ++k)
+                        term = multiply(term, values_[n]);
+                result = add(result, term);
+            }
+            return result;
+        }
+
+        //  the counter must change by a loop invariant step and the bound must not change
+        void orient(ClosedForm& form) const
+        {
+            const bool counterChanges = depends_on_state(form.counter);
+            const bool boundChanges = depends_on_state(form.bound);
+            if(counterChanges == boundChanges)
+                throw NotClosedForm{};
+            if(boundChanges)
+            {
+                std::swap(form.counter, form.bound);
+                switch(form.op)
+                {
+                    case ast::LogicOpType::LESS:     form.op = ast::LogicOpType::GREATER;  break;
+                    case ast::LogicOpType::GREATER:  form.op = ast::LogicOpType::LESS;     break;
+                    case ast::LogicOpType::LEQUAL:   form.op = ast::LogicOpType::GEQUAL;   break;
+                    case ast::LogicOpType::GEQUAL:   form.op = ast::LogicOpType::LEQUAL;   break;
+                    default:                         break;
+                }
+            }
+
+            form.step = subtract(after_iteration(form.counter), form.counter);
+            if(depends_on_state(form.step))
+                throw NotClosedForm{};
+        }
+
+        //  closes the set of monomials of the assigned variables under one iteration
+        void make_transition(ClosedForm& form) const
+        {
+            const std::size_t size = variables_.size();
+            std::map<Monomial, std::size_t> indices;
+            auto state = [&](const Monomial& monomial)
+            {
+                auto [iter, added] = indices.emplace(monomial, form.states.size());
+                if(added)
+                {
+                    if(form.states.size() == MAX_STATES)
+                        throw NotClosedForm{};
+                    form.states.push_back(monomial);
+                }
+                return iter->second;
+            };
+
+            state(Monomial(size, 0));
+            form.transition.push_back({{0, constant(size, 1)}});
+            for(std::size_t n = 0; n < size; ++n)
+                if(assigned_[n])
+                    form.results.emplace_back(n, state(variable(size, n).terms.begin()->first));
+
+            for(std::size_t row = 1; row < form.states.size(); ++row)
+            {
+                Polynomial monomial;
+                add_term(monomial, form.states[row], 1);
+
+                std::map<std::size_t, Polynomial> entries;
+                for(auto&& [term, coefficient] : after_iteration(monomial).terms)
+                {
+                    Monomial statePart(size, 0);
+                    Monomial invariantPart = term;
+                    for(std::size_t n = 0; n < size; ++n)
+                    {
+                        if(assigned_[n])
+                            std::swap(statePart[n], invariantPart[n]);
+                    }
+                    add_term(entries[state(statePart)], invariantPart, coefficient);
+                }
+                form.transition.emplace_back(entries.begin(), entries.end());
+            }
+        }
+    };
+}
+
+namespace ast
+{
+    std::uint32_t Polynomial::evaluate(const std::vector<std::uint32_t>& values) const
+    {
+        std::uint32_t result = 0;
+        for(auto&& [monomial, coefficient] : terms)
+            result += coefficient * evaluate_monomial(monomial, values);
+        return result;
+    }
+
+    std::optional<std::uint64_t> ClosedFormLoopNode::trip_count(const std::vector<std::uint32_t>& values) const
+    {
+        const std::int64_t counter = static_cast<std::int32_t>(form_.counter.evaluate(values));
+        const std::int64_t bound = static_cast<std::int32_t>(form_.bound.evaluate(values));
+        const std::uint32_t step = form_.step.evaluate(values);
+        const std::int64_t signedStep = static_cast<std::int32_t>(step);
+        constexpr std::int64_t MAX = std::numeric_limits<std::int32_t>::max();
+        constexpr std::int64_t MIN = std::numeric_limits<std::int32_t>::min();
+
+        //  counting up to last or down to last, the counter must not wrap before the exit
+        auto up = [&](const std::int64_t last) -> std::optional<std::uint64_t>
+        {
+            if(counter > last)
+                return 0;
+            if(signedStep <= 0)
+                return std::nullopt;
+            const std::int64_t trips = (last - counter) / signedStep + 1;
+            if(counter + trips * signedStep > MAX)
+                return std::nullopt;
+            return trips;
+        };
+        auto down = [&](const std::int64_t last) -> std::optional<std::uint64_t>
+        {
+            if(counter < last)
+                return 0;
+            if(signedStep >= 0)
+                return std::nullopt;
+            const std::int64_t trips = (counter - last) / -signedStep + 1;
+            if(counter + trips * signedStep < MIN)
+                return std::nullopt;
+            return trips;
+        };
+
+        switch(form_.op)
+        {
+            case LogicOpType::LESS:     return up(bound - 1);
+            case LogicOpType::LEQUAL:   return up(bound);
+            case LogicOpType::GREATER:  return down(bound + 1);
+            case LogicOpType::GEQUAL:   return down(bound);
+
+            case LogicOpType::EQUAL:    if(counter != bound)
+                                            return 0;
+                                        if(step == 0)
+                                            return std::nullopt;
+                                        return 1;
+
+            case LogicOpType::NEQUAL:   {
+                                          //  the first k with counter + k * step == bound modulo 2^32
+                                          const std::uint32_t distance = static_cast<std::uint32_t>(bound - counter);
+                                          if(distance == 0)
+                                              return 0;
+                                          if(step == 0)
+                                              return std::nullopt;
+                                          const int shift = std::countr_zero(step);
+                                          if(distance & ((std::uint32_t{1} << shift) - 1))
+                                              return std::nullopt;  //  never equal
+                                          const std::uint32_t odd = step >> shift;
+                                          std::uint32_t inverse = odd;  //  modulo 2^32, by Newton's iteration
+                                          for(int n = 0; n < 5; ++n)
+                                              inverse *= 2 - odd * inverse;
+                                          const std::uint64_t modulus = std::uint64_t{1} << (32 - shift);
+                                          return ((distance >> shift) * inverse) & (modulus - 1);
+                                        }
+
+            default:                    return std::nullopt;
+        }
+    }
+
+    void ClosedFormLoopNode::execute()
+    {
+        assert(loop_);
+        if(!execute_closed_form())
+            loop_->execute();
+    }
+
+    bool ClosedFormLoopNode::execute_closed_form()
+    {
+        assert(context_);
+        std::vector<std::uint32_t> values;
+        values.reserve(form_.variables.size());
+        for(auto&& var : form_.variables)
+            values.push_back(static_cast<std::uint32_t>(var->execute()));
+
+        const std::size_t size = form_.states.size();
+        const std::optional<std::uint64_t> trips = trip_count(values);
+        if(!trips || *trips <= size * size)  //  not known exactly, or short enough to just run
+            return false;
+        context_->count_steps(*trips);
+
+        Matrix transition(size * size, 0);
+        for(std::size_t row = 0; row < size; ++row)
+            for(auto&& [column, entry] : form_.transition[row])
+                transition[row * size + column] = entry.evaluate(values);
+
+        std::vector<std::uint32_t> state;
+        state.reserve(size);
+        for(auto&& monomial : form_.states)
+            state.push_back(evaluate_monomial(monomial, values));
+
+        for(std::uint64_t left = *trips; left; left >>= 1)
+        {
+            if(left & 1)
+                state = apply_matrix(transition, state);
+            if(left > 1)
+                transition = multiply(transition, transition, size);
+        }
+
+        for(auto&& [var, stateIndex] : form_.results)
+            form_.variables[var]->set_value(static_cast<int>(state[stateIndex]));
+        return true;
+    }
+
+    void fold_counting_loops(INode* node, Builder& builder)
+    {
+        assert(node);
+        for(auto&& child : node->get_children())
+            fold_counting_loops(child, builder);
+
+        if(!is<StatementWrapper>(node))
+            return;
+        auto wrapper = static_cast<StatementWrapper*>(node);
+        if(!is<WhileExpressionNode>(wrapper->get_statement()))
+            return;
+
+        auto loop = static_cast<WhileExpressionNode*>(wrapper->get_statement());
+        try
+        {
+            ClosedForm form = LoopAnalysis{}.analyze(loop);
+            wrapper->set_statement(builder.make_node<ClosedFormLoopNode>(loop, std::move(form), loop->get_context()));
+        }
+        catch(NotClosedForm&)  //  left as it is
+        {
+        }
+    }
+}   //  namespace ast
@@ -0,0 +1,603 @@
+//-------------------------------------------------------------------------------------------------
+//
+//  Protocol : every message is a frame of one type byte, a 4 byte big endian payload length and
+//  the payload. A request is a PROGRAM_TEXT or PROGRAM_PATH frame, an optional PROGRAM_NAME frame
+//  with the file a PROGRAM_TEXT was read from (its imports are resolved against the directory of
+//  the file), an optional INPUT frame with the whole input stream of the program and an END frame. The server answers with any number of
+//  STDOUT and STDERR frames followed by one EXIT frame carrying the exit status (4 bytes).
+//
+//-------------------------------------------------------------------------------------------------
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "content_hash.hpp"
+#include "file_content.hpp"
+#include "module.hpp"
+#include "server.hpp"
+
+namespace
+{
+    enum class Frame : char
+    {
+        PROGRAM_TEXT = 'T',
+        PROGRAM_PATH = 'P',
+        PROGRAM_NAME = 'N',
+        INPUT        = 'I',
+        END          = 'E',
+        STDOUT       = 'O',
+        STDERR       = 'R',
+        EXIT         = 'X'
+    };
+
+    constexpr std::uint32_t MAX_FRAME_SIZE = 256u << 20;
+    constexpr std::size_t CHECK_INTERVAL = 1u << 16;  //  loop iterations between client checks
+
+//-------------------------------------------------------------------------------------------------
+//      FRAMES
+    bool write_all(const int fd, const char* data, std::size_t size)
+    {
+        while(size > 0)
+        {
+            const ssize_t written = ::send(fd, data, size, MSG_NOSIGNAL);
+            if(written < 0 && errno == EINTR)
+                continue;
+            if(written <= 0)
+                return false;
+            data += written;
+            size -= static_cast<std::size_t>(written);
+        }
+        return true;
+    }
+
+    bool read_all(const int fd, char* data, std::size_t size)
+    {
+        while(size > 0)
+        {
+            const ssize_t received = ::recv(fd, data, size, 0);
+            if(received < 0 && errno == EINTR)
+                continue;
+            if(received <= 0)
+                return false;
+            data += received;
+            size -= static_cast<std::size_t>(received);
+        }
+        return true;
+    }
+
+    constexpr std::size_t HEADER_SIZE = 5;
+
+    void put_header(char* header, const Frame type, const std::size_t payloadSize)
+    {
+        const auto size = static_cast<std::uint32_t>(payloadSize);
+        header[0] = static_cast<char>(type);
+        header[1] = static_cast<char>(size >> 24);
+        header[2] = static_cast<char>(size >> 16);
+        header[3] = static_cast<char>(size >> 8);
+        header[4] = static_cast<char>(size);
+    }
+
+    bool send_frame(const int fd, const Frame type, std::string_view payload)
+    {
+        std::array<char, HEADER_SIZE> header;
+        put_header(header.data(), type, payload.size());
+        return write_all(fd, header.data(), header.size()) && write_all(fd, payload.data(), payload.size());
+    }
+
+    bool receive_frame(const int fd, Frame& type, std::string& payload)
+    {
+        std::array<unsigned char, HEADER_SIZE> header;
+        if(!read_all(fd, reinterpret_cast<char*>(header.data()), header.size()))
+            return false;
+
+        type = static_cast<Frame>(header[0]);
+        const std::uint32_t size = (std::uint32_t{header[1]} << 24) | (std::uint32_t{header[2]} << 16) |
+                                   (std::uint32_t{header[3]} << 8)  |  std::uint32_t{header[4]};
+        if(size > MAX_FRAME_SIZE)
+            return false;
+
+        payload.resize(size);
+        return read_all(fd, payload.data(), size);
+    }
+
+    //  a client sends nothing after its request, so a readable or hung up socket while the program
+    //  runs means the client has gone
+    bool client_gone(const int fd)
+    {
+        pollfd entry = { fd, POLLIN | POLLRDHUP, 0 };
+        return ::poll(&entry, 1, 0) > 0 && entry.revents != 0;
+    }
+
+    bool send_exit_status(const int fd, const int status)
+    {
+        const auto value = static_cast<std::uint32_t>(status);
+        const std::array<char, 4> payload = { static_cast<char>(value >> 24), static_cast<char>(value >> 16),
+                                              static_cast<char>(value >> 8),  static_cast<char>(value) };
+        return send_frame(fd, Frame::EXIT, std::string_view(payload.data(), payload.size()));
+    }
+
+    //  output stream buffer of a request : sends its content as a frame of the given type when it
+    //  is full or flushed, so the client gets the output while the program runs; the frame header
+    //  is written in front of the content to send both at once
+    class FrameStreambuf final : public std::streambuf
+    {
+        int fd_;
+        Frame type_;
+        std::array<char, HEADER_SIZE + 16384> buffer_;
+
+    public:
+        FrameStreambuf(const int fd, const Frame type) : fd_(fd), type_(type)
+        {
+            setp(buffer_.data() + HEADER_SIZE, buffer_.data() + buffer_.size());
+        }
+
+        bool send_pending()
+        {
+            const std::size_t size = static_cast<std::size_t>(pptr() - pbase());
+            setp(buffer_.data() + HEADER_SIZE, buffer_.data() + buffer_.size());
+            if(size == 0)
+                return true;
+            put_header(buffer_.data(), type_, size);
+            return write_all(fd_, buffer_.data(), HEADER_SIZE + size);
+        }
+
+    protected:
+        int_type overflow(int_type ch) override
+        {
+            if(!send_pending())
+                return traits_type::eof();
+            if(!traits_type::eq_int_type(ch, traits_type::eof()))
+            {
+                *pptr() = traits_type::to_char_type(ch);
+                pbump(1);
+            }
+            return traits_type::not_eof(ch);
+        }
+
+        int sync() override
+        {
+            return send_pending()? 0 : -1;
+        }
+    };
+
+//-------------------------------------------------------------------------------------------------
+//      PROGRAM CACHE
+    //  the AST keeps variable values and streams, so every request runs an instance of its own,
+    //  a copy of the compiled tree; instances are kept for the next requests
+    struct CompiledProgram
+    {
+        std::string source;
+        std::string directory;  //  imports are resolved against it
+        std::vector<modules::Dependency> dependencies;  //  imported files, checked on every hit
+        std::string diagnostics;  //  parser output, repeated to every client
+        std::unique_ptr<yy::Driver> driver;  //  never run, null if parsing was aborted by an error
+        std::mutex mutex;
+        std::vector<std::unique_ptr<yy::Driver>> idle;  //  instances no request is running
+    };
+
+    //  an instance of the program taken for one request, given back when the request is done
+    class ProgramInstance final
+    {
+        CompiledProgram& program_;
+        std::unique_ptr<yy::Driver> driver_;
+
+    public:
+        explicit ProgramInstance(CompiledProgram& program) : program_(program)
+        {
+            {
+                std::lock_guard lock(program_.mutex);
+                if(!program_.idle.empty())
+                {
+                    driver_ = std::move(program_.idle.back());
+                    program_.idle.pop_back();
+                    return;
+                }
+            }
+            driver_ = program_.driver->instantiate();  //  outside the lock, the template is only read
+        }
+
+        ProgramInstance(const ProgramInstance&) = delete;
+        ProgramInstance& operator=(const ProgramInstance&) = delete;
+
+        ~ProgramInstance()
+        {
+            std::lock_guard lock(program_.mutex);
+            program_.idle.push_back(std::move(driver_));
+        }
+
+        yy::Driver& driver() { return *driver_; }
+    };
+
+    class ProgramCache final
+    {
+        using Entry = std::shared_ptr<CompiledProgram>;
+
+        std::mutex mutex_;
+        std::size_t capacity_;
+        yy::Frontend frontend_;
+        std::size_t partialEvalBudget_;
+        bool foldLoops_;
+        std::list<Entry> lru_;  //  most recently used first
+        std::unordered_multimap<std::uint64_t, std::list<Entry>::iterator> index_;
+
+    public:
+        ProgramCache(const std::size_t capacity, const yy::Frontend frontend, const std::size_t partialEvalBudget,
+                     const bool foldLoops) :
+            capacity_(std::max<std::size_t>(capacity, 1)), frontend_(frontend), partialEvalBudget_(partialEvalBudget),
+            foldLoops_(foldLoops) {}
+
+        Entry get(const std::string& source, const modules::ImportOrigin& origin)
+        {
+            const std::uint64_t hash = utils::content_hash(source);
+            if(Entry program = find(hash, source, origin.directory))
+            {
+                if(modules::is_up_to_date(program->dependencies))
+                    return program;
+                erase(hash, program);  //  an imported file has changed
+            }
+
+            Entry program = compile(source, origin);  //  outside the lock, other requests go on meanwhile
+
+            std::lock_guard lock(mutex_);
+            if(Entry raced = find_locked(hash, source, origin.directory))
+                return raced;
+
+            lru_.push_front(program);
+            index_.emplace(hash, lru_.begin());
+            if(lru_.size() > capacity_)
+                evict_locked();
+            return program;
+        }
+
+    private:
+        Entry find(const std::uint64_t hash, const std::string& source, const std::string& directory)
+        {
+            std::lock_guard lock(mutex_);
+            return find_locked(hash, source, directory);
+        }
+
+        Entry find_locked(const std::uint64_t hash, const std::string& source, const std::string& directory)
+        {
+            auto [first, last] = index_.equal_range(hash);
+            for(auto iter = first; iter != last; ++iter)
+            {
+                if((*iter->second)->source != source || (*iter->second)->directory != directory)
+                    continue;
+                lru_.splice(lru_.begin(), lru_, iter->second);
+                return lru_.front();
+            }
+            return nullptr;
+        }
+
+        void erase(const std::uint64_t hash, const Entry& program)
+        {
+            std::lock_guard lock(mutex_);
+            auto [first, last] = index_.equal_range(hash);
+            for(auto iter = first; iter != last; ++iter)
+            {
+                if(*iter->second == program)
+                {
+                    lru_.erase(iter->second);
+                    index_.erase(iter);
+                    return;
+                }
+            }
+        }
+
+        void evict_locked()
+        {
+            const std::uint64_t hash = utils::content_hash(lru_.back()->source);
+            auto [first, last] = index_.equal_range(hash);
+            for(auto iter = first; iter != last; ++iter)
+            {
+                if(iter->second == std::prev(lru_.end()))
+                {
+                    index_.erase(iter);
+                    break;
+                }
+            }
+            lru_.pop_back();
+        }
+
+        Entry compile(const std::string& source, const modules::ImportOrigin& origin)
+        {
+            auto program = std::make_shared<CompiledProgram>();
+            program->source = source;
+            program->directory = origin.directory;
+            program->driver = std::make_unique<yy::Driver>(frontend_);
+
+            std::istringstream programStream(program->source);
+            std::ostringstream diagnostics;
+            program->driver->set_diagnostics_stream(diagnostics);
+            program->driver->set_input_stream(programStream);
+            program->driver->set_import_origin(origin);
+            try
+            {
+                program->driver->prefetch_imports(program->source);
+                program->driver->parse();
+                program->dependencies = program->driver->get_dependencies();
+                if(foldLoops_)
+                    program->driver->fold_loops();
+                if(partialEvalBudget_)  //  done once, every cached run starts from the precomputed state
+                    program->driver->partially_evaluate(partialEvalBudget_);
+            }
+            catch(std::exception& exptn)
+            {
+                diagnostics << exptn.what() << std::endl;
+                program->driver.reset();
+            }
+            program->diagnostics = diagnostics.str();
+            return program;
+        }
+    };
+
+//-------------------------------------------------------------------------------------------------
+//      REQUESTS
+    void handle_request(const int fd, ProgramCache& cache)
+    {
+        std::string source;
+        std::string input;
+        std::string payload;
+        Frame type;
+        bool hasProgram = false;
+        modules::ImportOrigin origin;
+
+        FrameStreambuf errBuf(fd, Frame::STDERR);
+        std::ostream err(&errBuf);
+
+        while(receive_frame(fd, type, payload))
+        {
+            switch(type)
+            {
+                case Frame::PROGRAM_TEXT:  source = std::move(payload);
+                                           hasProgram = true;
+                                           break;
+
+                case Frame::PROGRAM_PATH:  if(!utils::read_file(payload, source))
+                                           {
+                                               err << "error: " << std::endl;
+                                               err << "cannot open " << payload << std::endl;
+                                               errBuf.send_pending();
+                                               send_exit_status(fd, 1);
+                                               return;
+                                           }
+                                           origin = modules::file_origin(payload);
+                                           hasProgram = true;
+                                           break;
+
+                case Frame::PROGRAM_NAME:  origin = modules::file_origin(payload);
+                                           break;
+
+                case Frame::INPUT:         input = std::move(payload);
+                                           break;
+
+                case Frame::END:           {
+                                             if(!hasProgram)
+                                             {
+                                                 err << "error: " << std::endl;
+                                                 err << "no input files" << std::endl;
+                                                 errBuf.send_pending();
+                                                 send_exit_status(fd, 1);
+                                                 return;
+                                             }
+
+                                             FrameStreambuf outBuf(fd, Frame::STDOUT);
+                                             std::ostream out(&outBuf);
+                                             out.exceptions(std::ios::badbit);  //  a failed send stops the run
+                                             std::istringstream in(input);
+                                             int status = 1;
+                                             try
+                                             {
+                                                 std::shared_ptr<CompiledProgram> program = cache.get(source, origin);
+
+                                                 err << program->diagnostics;
+                                                 if(program->driver)
+                                                 {
+                                                     ProgramInstance instance(*program);
+                                                     instance.driver().set_diagnostics_stream(err);
+                                                     instance.driver().set_io_streams(in, out);
+                                                     instance.driver().get_context()->set_check([fd]
+                                                     {
+                                                         if(client_gone(fd))
+                                                             throw std::runtime_error("client disconnected");
+                                                     }, CHECK_INTERVAL);
+                                                     status = yy::run_program(instance.driver());
+                                                     instance.driver().get_context()->set_check({}, ast::ExecutionContext::UNLIMITED);
+                                                 }
+                                             }
+                                             catch(std::exception& exptn)
+                                             {
+                                                 err << exptn.what() << std::endl;
+                                             }
+                                             out.exceptions(std::ios::goodbit);
+                                             out.flush();
+                                             outBuf.send_pending();
+                                             errBuf.send_pending();
+                                             send_exit_status(fd, status);
+                                             return;
+                                           }
+
+                default:                   return;  //  not a request frame, drop the connection
+            }
+        }
+    }
+
+    class WorkerPool final
+    {
+        std::mutex mutex_;
+        std::condition_variable ready_;
+        std::queue<int> connections_;
+        std::vector<std::thread> workers_;
+
+    public:
+        WorkerPool(const std::size_t size, ProgramCache& cache)
+        {
+            for(std::size_t n = 0; n < size; ++n)
+                workers_.emplace_back([this, &cache] { work(cache); });
+        }
+
+        void submit(const int fd)
+        {
+            {
+                std::lock_guard lock(mutex_);
+                connections_.push(fd);
+            }
+            ready_.notify_one();
+        }
+
+    private:
+        void work(ProgramCache& cache)
+        {
+            for(;;)
+            {
+                int fd;
+                {
+                    std::unique_lock lock(mutex_);
+                    ready_.wait(lock, [this] { return !connections_.empty(); });
+                    fd = connections_.front();
+                    connections_.pop();
+                }
+                handle_request(fd, cache);
+                ::close(fd);
+            }
+        }
+    };
+
+    bool make_address(const std::string& socketPath, sockaddr_un& address, std::ostream& errors)
+    {
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if(socketPath.size() >= sizeof(address.sun_path))
+        {
+            errors << "error: " << std::endl;
+            errors << "socket path is too long: " << socketPath << std::endl;
+            return false;
+        }
+        std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+        return true;
+    }
+}   //  namespace
+
+namespace server
+{
+    int serve(const ServerOptions& options)
+    {
+        sockaddr_un address;
+        if(!make_address(options.socketPath, address, std::cerr))
+            return 1;
+
+        const int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        ::unlink(options.socketPath.c_str());
+        if(listener < 0 ||
+           ::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+           ::listen(listener, SOMAXCONN) < 0)
+        {
+            std::cerr << "error: " << std::endl;
+            std::cerr << "cannot listen on " << options.socketPath << ": " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+
+        std::signal(SIGPIPE, SIG_IGN);
+
+        const std::size_t workers = options.workers? options.workers
+                                                   : std::max(1u, std::thread::hardware_concurrency());
+        ProgramCache cache(options.cacheSize, options.frontend, options.partialEvalBudget, options.foldLoops);
+        modules::set_unit_cache_capacity(options.cacheSize);
+        WorkerPool pool(workers, cache);
+        std::cerr << "paraCL server is listening on " << options.socketPath << std::endl;
+
+        for(;;)
+        {
+            const int fd = ::accept(listener, nullptr, nullptr);
+            if(fd >= 0)
+                pool.submit(fd);
+            else if(errno != EINTR && errno != ECONNABORTED)
+            {
+                std::cerr << "error: " << std::endl;
+                std::cerr << "accept failed: " << std::strerror(errno) << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    int run_client(const std::string& socketPath, const std::string& fileName,
+                   std::istream& input, std::ostream& output, std::ostream& errors)
+    {
+        std::string source;
+        if(!utils::read_file(fileName, source))
+        {
+            errors << "error: " << std::endl;
+            errors << "cannot open " << fileName << std::endl;
+            return 1;
+        }
+
+        sockaddr_un address;
+        if(!make_address(socketPath, address, errors))
+            return 1;
+
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if(fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0)
+        {
+            errors << "error: " << std::endl;
+            errors << "cannot connect to " << socketPath << ": " << std::strerror(errno) << std::endl;
+            if(fd >= 0)
+                ::close(fd);
+            return 1;
+        }
+
+        std::ostringstream inputData;
+        inputData << input.rdbuf();
+
+        int status = 1;
+        std::error_code error;
+        const std::filesystem::path programName = std::filesystem::absolute(fileName, error);
+        bool finished = send_frame(fd, Frame::PROGRAM_TEXT, source) &&
+                        send_frame(fd, Frame::PROGRAM_NAME, error? fileName : programName.string()) &&
+                        send_frame(fd, Frame::INPUT, inputData.str()) &&
+                        send_frame(fd, Frame::END, {});
+
+        std::string payload;
+        Frame type;
+        while(finished && receive_frame(fd, type, payload))
+        {
+            if(type == Frame::STDOUT)
+                output << payload << std::flush;
+            else if(type == Frame::STDERR)
+                errors << payload << std::flush;
+            else if(type == Frame::EXIT && payload.size() == 4)
+            {
+                status = static_cast<int>((std::uint32_t{static_cast<unsigned char>(payload[0])} << 24) |
+                                          (std::uint32_t{static_cast<unsigned char>(payload[1])} << 16) |
+                                          (std::uint32_t{static_cast<unsigned char>(payload[2])} << 8)  |
+                                           std::uint32_t{static_cast<unsigned char>(payload[3])});
+                ::close(fd);
+                return status;
+            }
+        }
+
+        ::close(fd);
+        errors << "error: " << std::endl;
+        errors << "connection to " << socketPath << " was lost" << std::endl;
+        return status;
+    }
+}   //  namespace server
@@ -0,0 +1,70 @@
+import os
+import subprocess
+import sys
+import tempfile
+
+#   Runs every correct test with checkpoints written every few loop iterations, then resumes it
+#   from the last checkpoint written. Both the checkpointing run and the resumed one must print
+#   the expected answer. Options given to the script are passed to both runs.
+
+INTERVALS = (1, 2, 3, 5, 8, 13, 50)
+
+def read_file(file_path):
+    if os.path.exists(file_path):
+        with open(file_path, "r") as f:
+            return f.read()
+    return ""
+
+def run_paracl(args, input_data):
+    return subprocess.run(args, input=input_data, text=True, capture_output=True, check=False)
+
+def run_tests(options):
+    cpp_executable = os.path.join(os.path.dirname(__file__), "../../../build/paraCL")
+
+    if not os.path.isfile(cpp_executable) or not os.access(cpp_executable, os.X_OK):
+        print(f"File '{cpp_executable}' not found or not executable")
+        sys.exit(1)
+
+    current_directory = os.getcwd()
+    data_folder = os.path.join(current_directory, "data")
+    answers_folder = os.path.join(current_directory, "answers")
+    input_folder = os.path.join(current_directory, "input")
+
+    failed = []
+    restored = 0
+    with tempfile.TemporaryDirectory() as workdir:
+        checkpoint_path = os.path.join(workdir, "test.ckpt")
+        for test_file in sorted(os.listdir(data_folder)):
+            if not test_file.endswith(".pcl"):  #  imported modules live in subdirectories
+                continue
+            test_number = test_file.split('.')[0]
+            test_path = os.path.join(data_folder, test_file)
+            expected_output = read_file(os.path.join(answers_folder, f"{test_number}_answ.dat")).strip()
+            input_data = read_file(os.path.join(input_folder, f"{test_number}_input.dat"))
+
+            for interval in INTERVALS:
+                if os.path.exists(checkpoint_path):
+                    os.remove(checkpoint_path)
+
+                result = run_paracl([cpp_executable, *options, f"--checkpoint-every={interval}",
+                                     f"--checkpoint-file={checkpoint_path}", test_path], input_data)
+                if result.returncode != 0 or result.stdout.strip() != expected_output:
+                    failed.append(f"{test_number}(every {interval})")
+                    break
+
+                if not os.path.exists(checkpoint_path):  #  too few loop iterations
+                    continue
+                restored += 1
+                resumed = run_paracl([cpp_executable, *options, "--restore", checkpoint_path, test_path], input_data)
+                if resumed.returncode != 0 or resumed.stdout.strip() != expected_output:
+                    failed.append(f"{test_number}(restored, every {interval})")
+                    break
+
+    if failed:
+        print(f"Tests failed with checkpoints: {' '.join(failed)}")
+        sys.exit(1)
+    print(f"Tests passed with checkpoints ({restored} runs restored)")
+    sys.exit(0)
+
+if __name__ == "__main__":
+    run_tests(sys.argv[1:])
@@ -11,7 +11,7 @@ def read_file(file_path):
             return f.read()
     return ""
 
-def run_single_test(test_file):
+def run_single_test(test_file, options):
     cpp_executable = os.path.join(os.path.dirname(__file__), "../../../build/paraCL")
     
     if not os.path.isfile(cpp_executable) or not os.access(cpp_executable, os.X_OK):
@@ -40,7 +40,7 @@ def run_single_test(test_file):
 
     expected_output = read_file(answer_path)
     
-    args = [cpp_executable, test_path]
+    args = [cpp_executable, *options, test_path]
     try:
         result = subprocess.run(
             args,
@@ -62,9 +62,9 @@ def run_single_test(test_file):
         sys.exit(1)
 
 if __name__ == "__main__":
-    if len(sys.argv) != 2:
-        print("Usage: python3 run_tests.py <test_file>")
+    if len(sys.argv) < 2:
+        print("Usage: python3 run_tests.py <test_file> [paraCL options]")
         sys.exit(1)
     
     test_file = sys.argv[1]
-    run_single_test(test_file)
\ No newline at end of file
+    run_single_test(test_file, sys.argv[2:])
\ No newline at end of file
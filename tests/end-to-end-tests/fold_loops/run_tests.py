@@ -0,0 +1,147 @@
+import os
+import random
+import subprocess
+import sys
+
+#   Runs a program with and without --fold-loops, both runs must print the same output and
+#   errors and exit with the same status. Programs whose loops are too long to run as they are
+#   have an answers file, only the folded run is compared with it.
+#
+#   usage: python3 run_tests.py <test_file> [paraCL options]
+#          python3 run_tests.py --random <count> <seed> [paraCL options]
+#   the second form checks randomly generated counting loops.
+
+TIMEOUT = 60
+
+def read_file(file_path):
+    if os.path.exists(file_path):
+        with open(file_path, "r") as f:
+            return f.read()
+    return ""
+
+def run_paracl(args, input_data):
+    result = subprocess.run(args, input=input_data, text=True, capture_output=True,
+                            check=False, timeout=TIMEOUT)
+    return result.stdout, result.stderr, result.returncode
+
+def find_executable():
+    cpp_executable = os.path.join(os.path.dirname(__file__), "../../../build/paraCL")
+
+    if not os.path.isfile(cpp_executable) or not os.access(cpp_executable, os.X_OK):
+        print(f"File '{cpp_executable}' not found or not executable")
+        sys.exit(1)
+    return cpp_executable
+
+def run_single_test(test_file, options):
+    cpp_executable = find_executable()
+
+    current_directory = os.getcwd()
+    test_path = os.path.join(current_directory, "data", test_file)
+    test_number = test_file.split('.')[0]
+
+    answer_path = os.path.join(current_directory, "answers", f"{test_number}_answ.dat")
+    input_data = read_file(os.path.join(current_directory, "input", f"{test_number}_input.dat"))
+
+    folded = run_paracl([cpp_executable, *options, "--fold-loops", test_path], input_data)
+    if os.path.exists(answer_path):
+        passed = folded[2] == 0 and folded[0].strip() == read_file(answer_path).strip()
+    else:
+        passed = folded == run_paracl([cpp_executable, *options, test_path], input_data)
+
+    print(f"Test {test_number}: {'passed' if passed else 'failed'}")
+    sys.exit(0 if passed else 1)
+
+#   random programs : a few loops, each one has a counter and a body of polynomial assignments
+#   to a handful of variables; now and then the body also divides or prints, then the loop must
+#   be left as it is
+
+VARIABLES = ["a", "b", "c", "d"]
+
+def random_expression(rng, depth=0):
+    choice = rng.randrange(6 if depth < 2 else 2)
+    if choice == 0:
+        return str(rng.randint(-9, 9))
+    if choice == 1:
+        return rng.choice(VARIABLES + ["i"])
+    operation = rng.choice(["+", "-", "*", "+", "-"])
+    left = random_expression(rng, depth + 1)
+    right = random_expression(rng, depth + 1)
+    if choice == 5:
+        return f"-({left} {operation} {right})"
+    return f"({left} {operation} {right})"
+
+def random_loop(rng):
+    start = rng.randint(-3000, 3000)
+    step = rng.choice([1, 1, 2, 3, 7, 64, 1000])
+    trips = rng.choice([0, 1, 2, 50, rng.randint(0, 5000)])
+
+    kind = rng.choice(["<", "<=", ">", ">=", "!=", "count down"])
+    if kind in ("<", "<="):
+        bound, update = start + step * trips - (kind == "<="), f"i = i + {step};"
+    elif kind in (">", ">="):
+        bound, update = start - step * trips + (kind == ">="), f"i = i - {step};"
+    elif kind == "!=":
+        step = rng.choice([step, -step])
+        bound, update = start + step * trips, f"i = i + {step};"
+    else:
+        start, kind, bound, update = trips, "!=", 0, "i = i - 1;"
+    condition = rng.choice([f"i {kind} {bound}", f"{bound} {flip(kind)} i"])
+    if kind == "!=" and bound == 0:
+        condition = rng.choice([condition, "i"])
+
+    body = [f"{rng.choice(VARIABLES)} = {random_expression(rng)};" for _ in range(rng.randint(1, 4))]
+    body.insert(rng.randint(0, len(body)), update)
+    extra = rng.randrange(10)
+    if extra == 0:
+        body.insert(rng.randint(0, len(body)), f"a = a + b / (c - c + {rng.randint(0, 1)});")
+    elif extra == 1:
+        body.insert(rng.randint(0, len(body)), "print a;")
+
+    lines = [f"i = {start};", f"while ({condition})", "{"]
+    lines += [f"    {line}" for line in body]
+    lines += ["}", "print i;"] + [f"print {var};" for var in VARIABLES]
+    return lines
+
+def flip(operation):
+    return {"<": ">", "<=": ">=", ">": "<", ">=": "<=", "!=": "!="}[operation]
+
+def random_program(rng):
+    lines = [f"{var} = {rng.choice(['?', str(rng.randint(-100, 100))])};" for var in VARIABLES]
+    for _ in range(rng.randint(1, 3)):
+        lines += random_loop(rng)
+    return "\n".join(lines) + "\n"
+
+def run_random_tests(count, seed, options):
+    cpp_executable = find_executable()
+    rng = random.Random(seed)
+
+    program_path = os.path.join(os.getcwd(), f"random_{seed}.pcl")
+    failed = 0
+    try:
+        for number in range(count):
+            program = random_program(rng)
+            input_data = "\n".join(str(rng.randint(-1000, 1000)) for _ in VARIABLES) + "\n"
+            with open(program_path, "w") as program_file:
+                program_file.write(program)
+
+            original = run_paracl([cpp_executable, *options, program_path], input_data)
+            folded = run_paracl([cpp_executable, *options, "--fold-loops", program_path], input_data)
+            if original != folded:
+                failed += 1
+                print(f"Random program {number} differs:\n{program}input: {input_data}")
+    finally:
+        if os.path.exists(program_path):
+            os.remove(program_path)
+
+    print(f"Random programs: {count - failed} of {count} passed")
+    sys.exit(0 if failed == 0 else 1)
+
+if __name__ == "__main__":
+    if len(sys.argv) >= 4 and sys.argv[1] == "--random":
+        run_random_tests(int(sys.argv[2]), int(sys.argv[3]), sys.argv[4:])
+    if len(sys.argv) < 2:
+        print("Usage: python3 run_tests.py <test_file> [paraCL options]")
+        print("       python3 run_tests.py --random <count> <seed> [paraCL options]")
+        sys.exit(1)
+
+    run_single_test(sys.argv[1], sys.argv[2:])
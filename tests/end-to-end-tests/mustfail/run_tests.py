@@ -2,13 +2,27 @@ import os
 import subprocess
 import sys
 
+#   a run that does not finish in time has hung, for example waiting for an imported module
+TIMEOUT = 30
+
 def read_file(file_path):
     if os.path.exists(file_path):
         with open(file_path, "r") as f:
             return f.read()
     return ""
 
-def run_single_test(test_file):
+def run_paracl(args, input_data):
+    result = subprocess.run(
+        args,
+        input=input_data, 
+        text=True,
+        capture_output=True,  
+        check=False,
+        timeout=TIMEOUT
+    )
+    return result.stdout.strip(), result.stderr.strip(), result.returncode
+
+def run_single_test(test_file, options):
     cpp_executable = os.path.join(os.path.dirname(__file__), "../../../build/paraCL")
     
     if not os.path.isfile(cpp_executable) or not os.access(cpp_executable, os.X_OK):
@@ -27,21 +41,19 @@ def run_single_test(test_file):
     
     input_data = read_file(input_path)
 
-    args = [cpp_executable, test_path]
+    args = [cpp_executable, *options, test_path]
     try:
-        result = subprocess.run(
-            args,
-            input=input_data, 
-            text=True,
-            capture_output=True,  
-            check=False  
-        )
-        program_stdout = result.stdout.strip()
-        program_stderr = result.stderr.strip()  
+        program_stdout, program_stderr, returncode = run_paracl(args, input_data)
+        if options:  #  diagnostics must not depend on the options, compare with a default run
+            reference = run_paracl([cpp_executable, test_path], input_data)
     except Exception as e:
         print(f"Error while testing test: {test_number}: {e}")
         sys.exit(1)
     
+    if options and (program_stdout, program_stderr, returncode) != reference:
+        print(f"Test {test_number}: failed (output differs from the default run)")
+        sys.exit(1)
+
     if program_stdout != "" or program_stderr != "":
         print(f"Test {test_number}: passed (output detected)")
         sys.exit(0)
@@ -50,9 +62,9 @@ def run_single_test(test_file):
         sys.exit(1)
 
 if __name__ == "__main__":
-    if len(sys.argv) != 2:
-        print("Usage: python3 run_tests.py <test_file>")
+    if len(sys.argv) < 2:
+        print("Usage: python3 run_tests.py <test_file> [paraCL options]")
         sys.exit(1)
     
     test_file = sys.argv[1]
-    run_single_test(test_file)
\ No newline at end of file
+    run_single_test(test_file, sys.argv[2:])
\ No newline at end of file
@@ -0,0 +1,69 @@
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+#   Starts a server with one worker, runs endless programs through clients that are killed in
+#   the middle of the run, then checks that the worker is free again for the next request.
+#   Extra arguments are passed to the server.
+
+PROGRAMS = {
+    "printing": "i = 1;\nwhile (i) { print i; i = i + 1; }\n",
+    "quiet":    "i = 1;\nwhile (i) { i = i + 1; }\n",
+}
+TIMEOUT = 10
+
+def run_tests(options):
+    cpp_executable = os.path.join(os.path.dirname(__file__), "../../../build/paraCL")
+
+    if not os.path.isfile(cpp_executable) or not os.access(cpp_executable, os.X_OK):
+        print(f"File '{cpp_executable}' not found or not executable")
+        sys.exit(1)
+
+    with tempfile.TemporaryDirectory() as workdir:
+        socket_path = os.path.join(workdir, "paraCL.sock")
+        server = subprocess.Popen([cpp_executable, *options, "--workers=1", "--serve", socket_path],
+                                  stderr=subprocess.DEVNULL)
+        failed = []
+        try:
+            for _ in range(500):
+                if os.path.exists(socket_path):
+                    break
+                time.sleep(0.01)
+
+            finite_path = os.path.join(workdir, "finite.pcl")
+            with open(finite_path, "w") as program_file:
+                program_file.write("print 42;\n")
+
+            for name, program in PROGRAMS.items():
+                program_path = os.path.join(workdir, f"{name}.pcl")
+                with open(program_path, "w") as program_file:
+                    program_file.write(program)
+
+                client = subprocess.Popen([cpp_executable, "--client", socket_path, program_path],
+                                          stdin=subprocess.DEVNULL, stdout=subprocess.DEVNULL)
+                time.sleep(0.5)
+                client.kill()
+                client.wait()
+
+                try:
+                    result = subprocess.run([cpp_executable, "--client", socket_path, finite_path],
+                                            input="", text=True, capture_output=True,
+                                            check=False, timeout=TIMEOUT)
+                    if result.returncode != 0 or result.stdout.strip() != "42":
+                        failed.append(name)
+                except subprocess.TimeoutExpired:
+                    failed.append(name)
+        finally:
+            server.terminate()
+            server.wait()
+
+    if failed:
+        print(f"Server kept running programs of killed clients: {' '.join(failed)}")
+        sys.exit(1)
+    print("Programs of killed clients were stopped")
+    sys.exit(0)
+
+if __name__ == "__main__":
+    run_tests(sys.argv[1:])
@@ -0,0 +1,68 @@
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+#   Runs every correct test through "paraCL --client" against one "paraCL --serve" instance.
+#   Each test is sent twice, so the second run is served from the program cache.
+#   Extra arguments are passed to the server.
+
+def read_file(file_path):
+    if os.path.exists(file_path):
+        with open(file_path, "r") as f:
+            return f.read()
+    return ""
+
+def run_tests(options):
+    cpp_executable = os.path.join(os.path.dirname(__file__), "../../../build/paraCL")
+    
+    if not os.path.isfile(cpp_executable) or not os.access(cpp_executable, os.X_OK):
+        print(f"File '{cpp_executable}' not found or not executable")
+        sys.exit(1)
+
+    current_directory = os.getcwd()
+    data_folder = os.path.join(current_directory, "data")
+    answers_folder = os.path.join(current_directory, "answers")
+    input_folder = os.path.join(current_directory, "input")
+
+    with tempfile.TemporaryDirectory() as workdir:
+        socket_path = os.path.join(workdir, "paraCL.sock")
+        server = subprocess.Popen([cpp_executable, *options, "--serve", socket_path], stderr=subprocess.DEVNULL)
+        try:
+            for _ in range(500):
+                if os.path.exists(socket_path):
+                    break
+                time.sleep(0.01)
+
+            failed = []
+            for test_file in sorted(os.listdir(data_folder)):
+                if not test_file.endswith(".pcl"):  #  imported modules live in subdirectories
+                    continue
+                test_number = test_file.split('.')[0]
+                expected_output = read_file(os.path.join(answers_folder, f"{test_number}_answ.dat"))
+                input_data = read_file(os.path.join(input_folder, f"{test_number}_input.dat"))
+
+                for _ in range(2):
+                    result = subprocess.run(
+                        [cpp_executable, "--client", socket_path, os.path.join(data_folder, test_file)],
+                        input=input_data,
+                        text=True,
+                        capture_output=True,
+                        check=False
+                    )
+                    if result.returncode != 0 or result.stdout.strip() != expected_output.strip():
+                        failed.append(test_number)
+                        break
+        finally:
+            server.terminate()
+            server.wait()
+
+    if failed:
+        print(f"Tests failed through the server: {' '.join(failed)}")
+        sys.exit(1)
+    print("Tests passed through the server")
+    sys.exit(0)
+
+if __name__ == "__main__":
+    run_tests(sys.argv[1:])